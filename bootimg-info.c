@@ -1,183 +1,2022 @@
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+#include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
+#include <limits.h>
+#include <math.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/inotify.h>
+#include <sys/sendfile.h>
+#endif
 
 #include "bootimg.h"
 
 int usage()
 {
     printf("usage: bootimg-info boot.img\n");
+    printf("       bootimg-info --field name[,name...] boot.img\n");
+    printf("       bootimg-info --export out.bic <boot.img|-> [...]\n");
+    printf("       bootimg-info --fingerprint [--full] boot.img [expected]\n");
+    printf("       bootimg-info --audit boot.img\n");
+    printf("       bootimg-info --watch dir\n");
+    printf("       bootimg-info --extract <section[,section...]|all> boot.img [outdir]\n");
+    printf("       bootimg-info --patch boot.img [--cmdline \"...\"] [--os_version A.B.C]\n");
+    printf("                    [--os_patch_level YYYY-MM] [--bootconfig file]\n");
     return 1;
 }
 
-void print_os_version(uint32_t hdr_os_ver)
+#define SEEK_LIMIT 65536
+
+int seeklimit = SEEK_LIMIT; // arbitrary byte limit to search in input file for boot image magic
+int hdr_ver_max = 8; // arbitrary maximum header version value; when greater assume the field is appended dt size
+
+#define MTK_MAGIC "\x88\x16\x88\x58"
+#define MTK_MAGIC_SIZE 4
+#define LOKI_MAGIC "LOKI"
+#define LOKI_MAGIC_SIZE 4
+#define LOKI_OFFSET 0x400
+#define SEANDROID_MAGIC "SEANDROIDENFORCE"
+#define SEANDROID_MAGIC_SIZE 16
+#define ELF_MAGIC "\x7f""ELF"
+#define ELF_MAGIC_SIZE 4
+#define CHROMEOS_MAGIC "CHROMEOS"
+#define CHROMEOS_MAGIC_SIZE 8
+
+enum { SIG_BOOT, SIG_VENDOR_BOOT, SIG_MTK, SIG_COUNT };
+
+// signatures matched together with the boot magic in the single scan of the first seeklimit bytes
+struct {
+    char *name;
+    char *magic;
+    int size;
+} signatures[SIG_COUNT] = {
+    { "boot magic", BOOT_MAGIC, BOOT_MAGIC_SIZE },
+    { "vendor_boot magic", VENDOR_BOOT_MAGIC, VENDOR_BOOT_MAGIC_SIZE },
+    { "MTK header", MTK_MAGIC, MTK_MAGIC_SIZE },
+};
+
+#define MAX_WRAPPERS 16
+
+// vendor wrapper headers and trailers found around the boot image by the last find_magic() and find_section_wrappers()
+struct {
+    char *name;
+    int offset;
+    char detail[64];
+} wrappers[MAX_WRAPPERS];
+int wrapper_count = 0;
+
+void add_wrapper(char *name, int offset, char *detail)
+{
+    if (wrapper_count < MAX_WRAPPERS) {
+        wrappers[wrapper_count].name = name;
+        wrappers[wrapper_count].offset = offset;
+        snprintf(wrappers[wrapper_count].detail, sizeof(wrappers[wrapper_count].detail), "%s", detail);
+        wrapper_count++;
+    }
+}
+
+void decode_mtk_header(uint8_t *hdr, int offset)
+{
+    uint32_t size;
+    char detail[64];
+    memcpy(&size, hdr + 4, sizeof(size));
+    snprintf(detail, sizeof(detail), "%.32s, %u bytes", hdr + 8, size);
+    add_wrapper(signatures[SIG_MTK].name, offset, detail);
+}
+
+int find_magic(FILE *f, char **magic)
 {
-    int a = 0, b = 0, c = 0, y = 0, m = 0;
+    static uint8_t buf[SEEK_LIMIT + BOOT_MAGIC_SIZE]; // seeklimit plus the longest signature
+    // bitmask of the signatures starting with each byte value, so most positions cost one table lookup
+    static uint8_t first[256];
+    int s;
+    if (!first[(uint8_t)BOOT_MAGIC[0]]) {
+        for (s = 0; s < SIG_COUNT; s++) {
+            first[(uint8_t)signatures[s].magic[0]] |= 1 << s;
+        }
+    }
+
+    *magic = NULL;
+    wrapper_count = 0;
+    fseek(f, 0, SEEK_SET);
+    int len = fread(buf, 1, sizeof(buf), f);
+
+    int hits[SIG_COUNT];
+    for (s = 0; s < SIG_COUNT; s++) {
+        hits[s] = -1;
+    }
+    int i;
+    for (i = 0; i <= seeklimit && i < len; i++) {
+        uint8_t mask = first[buf[i]];
+        while (mask) {
+            s = __builtin_ctz(mask);
+            mask &= mask - 1;
+            if (i + signatures[s].size <= len && !memcmp(buf + i, signatures[s].magic, signatures[s].size)) {
+                if (s == SIG_MTK && hits[SIG_MTK] < 0 && i + 8 + 32 <= len) {
+                    decode_mtk_header(buf + i, i);
+                }
+                if (hits[s] < 0) {
+                    hits[s] = i;
+                }
+            }
+        }
+        if (hits[SIG_BOOT] >= 0 || hits[SIG_VENDOR_BOOT] >= 0) {
+            break;
+        }
+    }
+    if (i > seeklimit || i >= len) {
+        return -1;
+    }
+    *magic = hits[SIG_BOOT] >= 0 ? BOOT_MAGIC : VENDOR_BOOT_MAGIC;
+
+    // wrappers that only count at a fixed position relative to the file or the magic
+    char detail[64];
+    if (len >= 20 && !memcmp(buf, ELF_MAGIC, ELF_MAGIC_SIZE)) {
+        snprintf(detail, sizeof(detail), "%d-bit, machine %u", buf[4] == 2 ? 64 : 32, buf[18] | buf[19] << 8);
+        add_wrapper("ELF wrapper", 0, detail);
+    }
+    if (len >= 20 && !memcmp(buf, CHROMEOS_MAGIC, CHROMEOS_MAGIC_SIZE)) {
+        uint32_t major, minor, keyblock_size;
+        memcpy(&major, buf + 8, sizeof(major));
+        memcpy(&minor, buf + 12, sizeof(minor));
+        memcpy(&keyblock_size, buf + 16, sizeof(keyblock_size));
+        snprintf(detail, sizeof(detail), "keyblock v%u.%u, %u bytes", major, minor, keyblock_size);
+        add_wrapper("ChromeOS header", 0, detail);
+    }
+    // loki_patch places its header inside the boot header page, past the fields it has to keep
+    if (hits[SIG_BOOT] >= 0) {
+        uint8_t loki[LOKI_MAGIC_SIZE + 4 + 128 + 12];
+        fseek(f, i + LOKI_OFFSET, SEEK_SET);
+        if (fread(loki, sizeof(loki), 1, f) && !memcmp(loki, LOKI_MAGIC, LOKI_MAGIC_SIZE)) {
+            uint32_t recovery, orig_kernel_size, orig_ramdisk_size;
+            memcpy(&recovery, loki + 4, sizeof(recovery));
+            memcpy(&orig_kernel_size, loki + 136, sizeof(orig_kernel_size));
+            memcpy(&orig_ramdisk_size, loki + 140, sizeof(orig_ramdisk_size));
+            snprintf(detail, sizeof(detail), "%s, kernel %u, ramdisk %u bytes", recovery ? "recovery" : "boot", orig_kernel_size, orig_ramdisk_size);
+            add_wrapper("LOKI header", i + LOKI_OFFSET, detail);
+        }
+    }
+    return i;
+}
+
+int decode_os_version(uint32_t hdr_os_ver, int *a, int *b, int *c, int *y, int *m)
+{
+    *a = *b = *c = *y = *m = 0;
     if (hdr_os_ver != 0) {
         int os_version = 0, os_patch_level = 0;
         os_version = hdr_os_ver >> 11;
         os_patch_level = hdr_os_ver&0x7ff;
 
-        a = (os_version >> 14)&0x7f;
-        b = (os_version >> 7)&0x7f;
-        c = os_version&0x7f;
+        *a = (os_version >> 14)&0x7f;
+        *b = (os_version >> 7)&0x7f;
+        *c = os_version&0x7f;
+
+        *y = (os_patch_level >> 4) + 2000;
+        *m = os_patch_level&0xf;
+    }
+    return (*a < 128) && (*b < 128) && (*c < 128) && (*y >= 2000) && (*y < 2128) && (*m > 0) && (*m <= 12);
+}
+
+void print_os_version(uint32_t hdr_os_ver)
+{
+    int a, b, c, y, m;
+    if (decode_os_version(hdr_os_ver, &a, &b, &c, &y, &m)) {
+        printf("  os_version                      : %d.%d.%-5d  (%08x)\n", a, b, c, hdr_os_ver);
+        printf("  (os_patch_level)                : %d-%02d\n", y, m);
+    } else {
+        printf("  unused                          : %-10d  (%08x)\n", hdr_os_ver, hdr_os_ver);
+    }
+}
+
+void print_id(uint8_t *id)
+{
+    int SHA256_DIGEST_SIZE = 32;
+    printf("  id                              : ");
+    int i;
+    for (i = 0; i < SHA256_DIGEST_SIZE; ++i) {
+        printf("%02hhx", id[i]);
+    }
+    printf("\n");
+}
+
+enum { FT_MAGIC, FT_SIZE, FT_ADDR, FT_SIZE64, FT_ADDR64, FT_OS_VERSION, FT_OS_PATCH_LEVEL, FT_STR, FT_ID };
+
+#define VER_ANY INT_MAX // and every later version
+
+#define F_GAP 1   // followed by a blank line in the full printout
+#define F_QUERY 2 // only reported by --field, print_os_version() covers it in the full printout
+
+typedef struct {
+    char *name;
+    int offset;
+    int width;
+    int type;
+    int min_ver; // header versions the field exists in; -1 is a pre-v1 header with dt_size in place of header_version
+    int max_ver;
+    int flags;
+} hdr_field;
+
+#define FIELD(hdr, field, type, min_ver, max_ver, flags) \
+    { #field, offsetof(hdr, field), sizeof(((hdr *)0)->field), type, min_ver, max_ver, flags }
+#define RESERVED(hdr, n, flags) \
+    { "reserved[" #n "]", offsetof(hdr, reserved) + (n - 1) * sizeof(uint32_t), sizeof(uint32_t), FT_SIZE, 3, VER_ANY, flags }
+
+// boot_img_hdr_v2 in the backported header supports all boot_img_hdr versions and cross-compatible variants below 3
+hdr_field boot_v0_fields[] = {
+    FIELD(boot_img_hdr_v2, magic, FT_MAGIC, -1, 2, 0),
+    FIELD(boot_img_hdr_v2, kernel_size, FT_SIZE, -1, 2, 0),
+    FIELD(boot_img_hdr_v2, kernel_addr, FT_ADDR, -1, 2, F_GAP),
+    FIELD(boot_img_hdr_v2, ramdisk_size, FT_SIZE, -1, 2, 0),
+    FIELD(boot_img_hdr_v2, ramdisk_addr, FT_ADDR, -1, 2, 0),
+    FIELD(boot_img_hdr_v2, second_size, FT_SIZE, -1, 2, 0),
+    FIELD(boot_img_hdr_v2, second_addr, FT_ADDR, -1, 2, F_GAP),
+    FIELD(boot_img_hdr_v2, tags_addr, FT_ADDR, -1, 2, 0),
+    FIELD(boot_img_hdr_v2, page_size, FT_SIZE, -1, 2, 0),
+    FIELD(boot_img_hdr_v2, dt_size, FT_SIZE, -1, -1, 0),
+    FIELD(boot_img_hdr_v2, header_version, FT_SIZE, 0, 2, 0),
+    FIELD(boot_img_hdr_v2, os_version, FT_OS_VERSION, -1, 2, F_GAP),
+    { "os_patch_level", offsetof(boot_img_hdr_v2, os_version), sizeof(uint32_t), FT_OS_PATCH_LEVEL, -1, 2, F_QUERY },
+    FIELD(boot_img_hdr_v2, name, FT_STR, -1, 2, F_GAP),
+    FIELD(boot_img_hdr_v2, cmdline, FT_STR, -1, 2, F_GAP),
+    FIELD(boot_img_hdr_v2, id, FT_ID, -1, 2, F_GAP),
+    FIELD(boot_img_hdr_v2, extra_cmdline, FT_STR, -1, 2, F_GAP),
+    FIELD(boot_img_hdr_v2, recovery_dtbo_size, FT_SIZE, 1, 2, 0),
+    FIELD(boot_img_hdr_v2, recovery_dtbo_offset, FT_SIZE64, 1, 2, 0),
+    FIELD(boot_img_hdr_v2, header_size, FT_SIZE, 1, 2, F_GAP),
+    FIELD(boot_img_hdr_v2, dtb_size, FT_SIZE, 2, 2, 0),
+    FIELD(boot_img_hdr_v2, dtb_addr, FT_ADDR64, 2, 2, F_GAP),
+};
+
+// boot_img_hdr_v3 and above are no longer backwards compatible
+hdr_field boot_v3_fields[] = {
+    FIELD(boot_img_hdr_v4, magic, FT_MAGIC, 3, VER_ANY, 0),
+    FIELD(boot_img_hdr_v4, kernel_size, FT_SIZE, 3, VER_ANY, 0),
+    FIELD(boot_img_hdr_v4, ramdisk_size, FT_SIZE, 3, VER_ANY, F_GAP),
+    FIELD(boot_img_hdr_v4, os_version, FT_OS_VERSION, 3, VER_ANY, 0),
+    { "os_patch_level", offsetof(boot_img_hdr_v4, os_version), sizeof(uint32_t), FT_OS_PATCH_LEVEL, 3, VER_ANY, F_QUERY },
+    FIELD(boot_img_hdr_v4, header_size, FT_SIZE, 3, VER_ANY, 0),
+    RESERVED(boot_img_hdr_v4, 1, 0),
+    RESERVED(boot_img_hdr_v4, 2, F_GAP),
+    RESERVED(boot_img_hdr_v4, 3, 0),
+    RESERVED(boot_img_hdr_v4, 4, 0),
+    FIELD(boot_img_hdr_v4, header_version, FT_SIZE, 3, VER_ANY, 0),
+    FIELD(boot_img_hdr_v4, cmdline, FT_STR, 3, VER_ANY, 0),
+    FIELD(boot_img_hdr_v4, signature_size, FT_SIZE, 4, VER_ANY, 0),
+};
+
+// vendor_boot_img_hdr started at v3 and is not cross-compatible with boot_img_hdr
+hdr_field vendor_fields[] = {
+    FIELD(vendor_boot_img_hdr_v4, magic, FT_MAGIC, -1, VER_ANY, 0),
+    FIELD(vendor_boot_img_hdr_v4, header_version, FT_SIZE, -1, VER_ANY, 0),
+    FIELD(vendor_boot_img_hdr_v4, page_size, FT_SIZE, -1, VER_ANY, F_GAP),
+    FIELD(vendor_boot_img_hdr_v4, kernel_addr, FT_ADDR, -1, VER_ANY, 0),
+    FIELD(vendor_boot_img_hdr_v4, ramdisk_addr, FT_ADDR, -1, VER_ANY, 0),
+    FIELD(vendor_boot_img_hdr_v4, vendor_ramdisk_size, FT_SIZE, -1, VER_ANY, 0),
+    FIELD(vendor_boot_img_hdr_v4, cmdline, FT_STR, -1, VER_ANY, 0),
+    FIELD(vendor_boot_img_hdr_v4, tags_addr, FT_ADDR, -1, VER_ANY, F_GAP),
+    FIELD(vendor_boot_img_hdr_v4, name, FT_STR, -1, VER_ANY, F_GAP),
+    FIELD(vendor_boot_img_hdr_v4, header_size, FT_SIZE, -1, VER_ANY, 0),
+    FIELD(vendor_boot_img_hdr_v4, dtb_size, FT_SIZE, -1, VER_ANY, 0),
+    FIELD(vendor_boot_img_hdr_v4, dtb_addr, FT_ADDR64, -1, VER_ANY, F_GAP),
+    FIELD(vendor_boot_img_hdr_v4, vendor_ramdisk_table_size, FT_SIZE, 4, VER_ANY, 0),
+    FIELD(vendor_boot_img_hdr_v4, vendor_ramdisk_table_entry_num, FT_SIZE, 4, VER_ANY, 0),
+    FIELD(vendor_boot_img_hdr_v4, vendor_ramdisk_table_entry_size, FT_SIZE, 4, VER_ANY, 0),
+    FIELD(vendor_boot_img_hdr_v4, bootconfig_size, FT_SIZE, 4, VER_ANY, F_GAP),
+};
+
+#define FIELD_COUNT(fields) (sizeof(fields) / sizeof(fields[0]))
+
+// pick the field table for the header at hdr and the version its fields are gated on
+hdr_field *select_fields(char *magic, uint8_t *hdr, int *count, int *version)
+{
+    if (strcmp(magic, BOOT_MAGIC)) {
+        uint32_t header_version = ((vendor_boot_img_hdr_v4 *)hdr)->header_version;
+        *version = header_version > VER_ANY ? VER_ANY : header_version;
+        *count = FIELD_COUNT(vendor_fields);
+        return vendor_fields;
+    }
+    uint32_t header_version = ((boot_img_hdr_v2 *)hdr)->header_version;
+    if (header_version > hdr_ver_max) {
+        *version = -1;
+    } else {
+        *version = header_version;
+    }
+    if (*version < 3) {
+        *count = FIELD_COUNT(boot_v0_fields);
+        return boot_v0_fields;
+    }
+    *count = FIELD_COUNT(boot_v3_fields);
+    return boot_v3_fields;
+}
+
+void print_fields(hdr_field *fields, int count, int version, uint8_t *hdr)
+{
+    int n;
+    for (n = 0; n < count; n++) {
+        hdr_field *field = &fields[n];
+        if (version < field->min_ver || version > field->max_ver || (field->flags & F_QUERY)) {
+            continue;
+        }
+        uint8_t *p = hdr + field->offset;
+        uint32_t v32 = 0;
+        uint64_t v64 = 0;
+        memcpy(&v32, p, field->width < sizeof(v32) ? field->width : sizeof(v32));
+        memcpy(&v64, p, field->width < sizeof(v64) ? field->width : sizeof(v64));
+        switch (field->type) {
+            case FT_OS_VERSION:
+                print_os_version(v32);
+                break;
+            case FT_ID:
+                print_id(p);
+                break;
+            case FT_MAGIC:
+            case FT_STR:
+                printf("  %-31s : %.*s\n", field->name, field->width, p);
+                break;
+            case FT_SIZE:
+                printf("  %-31s : %-10d  (%08x)\n", field->name, v32, v32);
+                break;
+            case FT_ADDR:
+                printf("  %-31s : 0x%08x\n", field->name, v32);
+                break;
+            case FT_SIZE64:
+                printf("  %-31s : %-10"PRId64"  (%016"PRIx64")\n", field->name, v64, v64);
+                break;
+            case FT_ADDR64:
+                printf("  %-31s : 0x%08"PRIx64"  (%016"PRIx64")\n", field->name, v64, v64);
+                break;
+        }
+        if (field->flags & F_GAP) {
+            printf("\n");
+        }
+    }
+}
+
+// the header bytes following the boot magic, for decoding through the field tables; returns the error, if any
+char *read_header_window(char *filename, uint8_t *hdr, size_t size, char **magic, int *offset)
+{
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        return "File not found!";
+    }
+    *offset = find_magic(f, magic);
+    if (*offset < 0) {
+        fclose(f);
+        return "No boot image magic found!";
+    }
+    memset(hdr, 0, size);
+    fseek(f, *offset, SEEK_SET);
+    if(fread(hdr, size, 1, f)){};
+    fclose(f);
+    return NULL;
+}
+
+// values come from the image or the watched directory, so escape anything that could break the one key=value per line output
+void print_escaped(uint8_t *p, size_t max)
+{
+    size_t n;
+    for (n = 0; n < max && p[n]; n++) {
+        if (p[n] < 0x20 || p[n] >= 0x7f || p[n] == '\\') {
+            printf("\\x%02x", p[n]);
+        } else {
+            putchar(p[n]);
+        }
+    }
+}
+
+void print_field_value(hdr_field *field, uint8_t *hdr)
+{
+    uint8_t *p = hdr + field->offset;
+    uint32_t v32 = 0;
+    uint64_t v64 = 0;
+    memcpy(&v32, p, field->width < sizeof(v32) ? field->width : sizeof(v32));
+    memcpy(&v64, p, field->width < sizeof(v64) ? field->width : sizeof(v64));
+    int a, b, c, y, m;
+    int valid = decode_os_version(v32, &a, &b, &c, &y, &m);
+    printf("%s=", field->name);
+    switch (field->type) {
+        case FT_OS_VERSION:
+            if (valid) {
+                printf("%d.%d.%d", a, b, c);
+            }
+            break;
+        case FT_OS_PATCH_LEVEL:
+            if (valid) {
+                printf("%d-%02d", y, m);
+            }
+            break;
+        case FT_ID:
+            for (m = 0; m < field->width; m++) {
+                printf("%02hhx", p[m]);
+            }
+            break;
+        case FT_MAGIC:
+        case FT_STR:
+            print_escaped(p, field->width);
+            break;
+        case FT_SIZE:
+            printf("%u", v32);
+            break;
+        case FT_ADDR:
+            printf("0x%08x", v32);
+            break;
+        case FT_SIZE64:
+            printf("%"PRIu64, v64);
+            break;
+        case FT_ADDR64:
+            printf("0x%08"PRIx64, v64);
+            break;
+    }
+    printf("\n");
+}
+
+int query_fields(char *filename, char *names)
+{
+    uint8_t hdr[sizeof(vendor_boot_img_hdr_v4)];
+    char *magic;
+    int offset;
+    char *error = read_header_window(filename, hdr, sizeof(hdr), &magic, &offset);
+    if (error) {
+        printf("bootimg-info: %s\n", error);
+        return 1;
+    }
+
+    int field_count, version;
+    hdr_field *fields = select_fields(magic, hdr, &field_count, &version);
+
+    int ret = 0;
+    char *name = names;
+    while (*name) {
+        size_t len = strcspn(name, ",");
+        int n;
+        for (n = 0; n < field_count; n++) {
+            if (strlen(fields[n].name) == len && !strncmp(fields[n].name, name, len)
+                    && version >= fields[n].min_ver && version <= fields[n].max_ver) {
+                break;
+            }
+        }
+        if (n == field_count) {
+            printf("bootimg-info: Field \"%.*s\" not in this header!\n", (int)len, name);
+            ret = 1;
+        } else {
+            print_field_value(&fields[n], hdr);
+        }
+        name += len;
+        if (*name == ',') {
+            name++;
+        }
+    }
+    return ret;
+}
+
+// one machine-readable record: a path= line, every header field as name=value, then a blank line
+int print_record(char *filename)
+{
+    uint8_t hdr[sizeof(vendor_boot_img_hdr_v4)];
+    char *magic;
+    int offset;
+    printf("path=");
+    print_escaped((uint8_t *)filename, strlen(filename));
+    printf("\n");
+    char *error = read_header_window(filename, hdr, sizeof(hdr), &magic, &offset);
+    if (error) {
+        printf("error=%s\n\n", error);
+        return 1;
+    }
+    printf("magic_offset=%d\n", offset);
+
+    int field_count, version;
+    hdr_field *fields = select_fields(magic, hdr, &field_count, &version);
+    int n;
+    for (n = 0; n < field_count; n++) {
+        if (version >= fields[n].min_ver && version <= fields[n].max_ver) {
+            print_field_value(&fields[n], hdr);
+        }
+    }
+    printf("\n");
+    return 0;
+}
+
+int pages(uint32_t size, uint32_t page_size)
+{
+    if (page_size == 0) {
+        return 0;
+    }
+    return (size + page_size - 1) / page_size;
+}
+
+char *rdt_type_name(uint32_t ramdisk_type)
+{
+    switch (ramdisk_type) {
+        case VENDOR_RAMDISK_TYPE_NONE:
+            return "NONE";
+        case VENDOR_RAMDISK_TYPE_PLATFORM:
+            return "PLATFORM";
+        case VENDOR_RAMDISK_TYPE_RECOVERY:
+            return "RECOVERY";
+        case VENDOR_RAMDISK_TYPE_DLKM:
+            return "DLKM";
+    }
+    return "UNKNOWN";
+}
+
+// header fields of any boot or vendor_boot image version flattened into one record; fields a version lacks stay 0
+typedef struct {
+    char *magic;
+    int magic_offset;
+
+    uint32_t header_version;
+    uint32_t dt_size;
+    uint32_t page_size;
+
+    uint32_t kernel_size;
+    uint32_t kernel_addr;
+    uint32_t ramdisk_size;
+    uint32_t ramdisk_addr;
+    uint32_t second_size;
+    uint32_t second_addr;
+    uint32_t tags_addr;
+
+    uint32_t os_version;
+    char name[VENDOR_BOOT_NAME_SIZE + 1];
+    char cmdline[VENDOR_BOOT_ARGS_SIZE + 1];
+    char extra_cmdline[BOOT_EXTRA_ARGS_SIZE + 1];
+    uint8_t id[32];
+
+    uint32_t recovery_dtbo_size;
+    uint64_t recovery_dtbo_offset;
+    uint32_t header_size;
+    uint32_t dtb_size;
+    uint64_t dtb_addr;
+    uint32_t signature_size;
+
+    uint32_t vendor_ramdisk_size;
+    uint32_t vendor_ramdisk_table_size;
+    uint32_t vendor_ramdisk_table_entry_num;
+    uint32_t vendor_ramdisk_table_entry_size;
+    uint32_t bootconfig_size;
+
+    uint32_t base;
+    uint32_t rdt_offset;
+    uint32_t bc_offset;
+
+    uint64_t file_size;
+} img_info;
+
+int read_img_info(FILE *f, img_info *info)
+{
+    memset(info, 0, sizeof(*info));
+    fseek(f, 0, SEEK_END);
+    info->file_size = ftell(f);
+    info->magic_offset = find_magic(f, &info->magic);
+    if (info->magic_offset < 0) {
+        return -1;
+    }
+
+    boot_img_hdr_v4 header;
+    fseek(f, info->magic_offset, SEEK_SET);
+    if(fread(&header, sizeof(header), 1, f)){};
+
+    if (!strcmp(info->magic, BOOT_MAGIC)) {
+        if ((header.header_version < 3) || (header.header_version > hdr_ver_max)) {
+            fseek(f, info->magic_offset, SEEK_SET);
+            boot_img_hdr_v2 header;
+            memset(&header, 0, sizeof(header));
+            if(fread(&header, sizeof(header), 1, f)){};
+
+            if (header.header_version > hdr_ver_max) {
+                info->dt_size = header.dt_size;
+            } else {
+                info->header_version = header.header_version;
+            }
+            info->page_size = header.page_size;
+            info->kernel_size = header.kernel_size;
+            info->kernel_addr = header.kernel_addr;
+            info->ramdisk_size = header.ramdisk_size;
+            info->ramdisk_addr = header.ramdisk_addr;
+            info->second_size = header.second_size;
+            info->second_addr = header.second_addr;
+            info->tags_addr = header.tags_addr;
+            info->os_version = header.os_version;
+            memcpy(info->name, header.name, BOOT_NAME_SIZE);
+            memcpy(info->cmdline, header.cmdline, BOOT_ARGS_SIZE);
+            memcpy(info->extra_cmdline, header.extra_cmdline, BOOT_EXTRA_ARGS_SIZE);
+            memcpy(info->id, header.id, sizeof(info->id));
+            if (info->header_version > 0) {
+                info->recovery_dtbo_size = header.recovery_dtbo_size;
+                info->recovery_dtbo_offset = header.recovery_dtbo_offset;
+                info->header_size = header.header_size;
+            }
+            if (info->header_version > 1) {
+                info->dtb_size = header.dtb_size;
+                info->dtb_addr = header.dtb_addr;
+            }
+            info->base = header.kernel_addr - 0x00008000;
+        } else {
+            info->header_version = header.header_version;
+            info->page_size = 4096; // fixed for boot_img_hdr_v3 and above
+            info->kernel_size = header.kernel_size;
+            info->ramdisk_size = header.ramdisk_size;
+            info->os_version = header.os_version;
+            info->header_size = header.header_size;
+            memcpy(info->cmdline, header.cmdline, BOOT_ARGS_SIZE + BOOT_EXTRA_ARGS_SIZE);
+            if (header.header_version > 3) {
+                info->signature_size = header.signature_size;
+            }
+        }
+    } else {
+        fseek(f, info->magic_offset, SEEK_SET);
+        vendor_boot_img_hdr_v4 header;
+        memset(&header, 0, sizeof(header));
+        if(fread(&header, sizeof(header), 1, f)){};
+
+        info->header_version = header.header_version;
+        info->page_size = header.page_size;
+        info->kernel_addr = header.kernel_addr;
+        info->ramdisk_addr = header.ramdisk_addr;
+        info->vendor_ramdisk_size = header.vendor_ramdisk_size;
+        memcpy(info->cmdline, header.cmdline, VENDOR_BOOT_ARGS_SIZE);
+        info->tags_addr = header.tags_addr;
+        memcpy(info->name, header.name, VENDOR_BOOT_NAME_SIZE);
+        info->header_size = header.header_size;
+        info->dtb_size = header.dtb_size;
+        info->dtb_addr = header.dtb_addr;
+        if (header.header_version > 3) {
+            info->vendor_ramdisk_table_size = header.vendor_ramdisk_table_size;
+            info->vendor_ramdisk_table_entry_num = header.vendor_ramdisk_table_entry_num;
+            info->vendor_ramdisk_table_entry_size = header.vendor_ramdisk_table_entry_size;
+            info->bootconfig_size = header.bootconfig_size;
+
+            info->rdt_offset = (pages(header.header_size, header.page_size)
+                + pages(header.vendor_ramdisk_size, header.page_size)
+                + pages(header.dtb_size, header.page_size)) * header.page_size;
+            info->bc_offset = info->rdt_offset
+                + pages(header.vendor_ramdisk_table_size, header.page_size) * header.page_size;
+        }
+        info->base = header.kernel_addr - 0x00008000;
+    }
+    return 0;
+}
+
+// entries the vendor ramdisk table can actually hold, so a corrupt entry_num cannot run past the table
+uint32_t rdt_entry_count(img_info *info)
+{
+    if (info->vendor_ramdisk_table_entry_size == 0) {
+        return 0;
+    }
+    uint32_t max = info->vendor_ramdisk_table_size / info->vendor_ramdisk_table_entry_size;
+    return info->vendor_ramdisk_table_entry_num < max ? info->vendor_ramdisk_table_entry_num : max;
+}
+
+// read the next table entry, whose on-disk size may be smaller or larger than the v4 struct
+void read_rdt_entry(FILE *f, img_info *info, vendor_ramdisk_table_entry_v4 *rdt_entry)
+{
+    memset(rdt_entry, 0, sizeof(*rdt_entry));
+    if (info->vendor_ramdisk_table_entry_size < sizeof(*rdt_entry)) {
+        if(fread(rdt_entry, info->vendor_ramdisk_table_entry_size, 1, f)){};
+    } else {
+        if(fread(rdt_entry, sizeof(*rdt_entry), 1, f)){};
+        fseek(f, info->vendor_ramdisk_table_entry_size - sizeof(*rdt_entry), SEEK_CUR);
+    }
+}
+
+#define MAX_SECTIONS 64
+
+enum {
+    SECTION_HEADER,
+    SECTION_KERNEL,
+    SECTION_RAMDISK,
+    SECTION_SECOND,
+    SECTION_DT,
+    SECTION_RECOVERY_DTBO,
+    SECTION_DTB,
+    SECTION_SIGNATURE,
+    SECTION_VENDOR_RAMDISK,
+    SECTION_VENDOR_RAMDISK_TABLE,
+    SECTION_BOOTCONFIG,
+    SECTION_VENDOR_RAMDISK_FRAGMENT, // one vendor ramdisk table entry, inside SECTION_VENDOR_RAMDISK
+};
+
+typedef struct {
+    int kind;
+    char name[32];
+    char label[VENDOR_RAMDISK_NAME_SIZE + 1]; // sanitized ramdisk_name of a fragment, for display and selection only
+    uint64_t offset; // in the input file, including the magic offset
+    uint64_t size;
+} img_section;
+
+void add_section(img_section *sections, int *count, int kind, char *name, uint64_t offset, uint64_t size)
+{
+    if (*count < MAX_SECTIONS) {
+        sections[*count].kind = kind;
+        snprintf(sections[*count].name, sizeof(sections[*count].name), "%s", name);
+        sections[*count].label[0] = '\0';
+        sections[*count].offset = offset;
+        sections[*count].size = size;
+        (*count)++;
+    }
+}
+
+// page aligned section geometry as laid out by mkbootimg, see the diagrams in bootimg.h
+int read_sections(FILE *f, img_info *info, img_section *sections)
+{
+    int count = 0;
+    uint64_t page_size = info->page_size;
+    uint64_t offset = info->magic_offset;
+
+    if (!strcmp(info->magic, BOOT_MAGIC)) {
+        if (info->header_version < 3) {
+            add_section(sections, &count, SECTION_HEADER, "header", offset, page_size);
+            offset += page_size;
+            add_section(sections, &count, SECTION_KERNEL, "kernel", offset, info->kernel_size);
+            offset += pages(info->kernel_size, page_size) * page_size;
+            add_section(sections, &count, SECTION_RAMDISK, "ramdisk", offset, info->ramdisk_size);
+            offset += pages(info->ramdisk_size, page_size) * page_size;
+            if (info->second_size) {
+                add_section(sections, &count, SECTION_SECOND, "second", offset, info->second_size);
+                offset += pages(info->second_size, page_size) * page_size;
+            }
+            if (info->dt_size) {
+                add_section(sections, &count, SECTION_DT, "dt", offset, info->dt_size);
+                offset += pages(info->dt_size, page_size) * page_size;
+            }
+            if (info->recovery_dtbo_size) {
+                add_section(sections, &count, SECTION_RECOVERY_DTBO, "recovery_dtbo", offset, info->recovery_dtbo_size);
+                offset += pages(info->recovery_dtbo_size, page_size) * page_size;
+            }
+            if (info->dtb_size) {
+                add_section(sections, &count, SECTION_DTB, "dtb", offset, info->dtb_size);
+            }
+        } else {
+            add_section(sections, &count, SECTION_HEADER, "header", offset, page_size);
+            offset += page_size;
+            add_section(sections, &count, SECTION_KERNEL, "kernel", offset, info->kernel_size);
+            offset += pages(info->kernel_size, page_size) * page_size;
+            add_section(sections, &count, SECTION_RAMDISK, "ramdisk", offset, info->ramdisk_size);
+            offset += pages(info->ramdisk_size, page_size) * page_size;
+            if (info->signature_size) {
+                add_section(sections, &count, SECTION_SIGNATURE, "signature", offset, info->signature_size);
+            }
+        }
+    } else {
+        add_section(sections, &count, SECTION_HEADER, "header", offset, pages(info->header_size, page_size) * page_size);
+        offset += pages(info->header_size, page_size) * page_size;
+        add_section(sections, &count, SECTION_VENDOR_RAMDISK, "vendor_ramdisk", offset, info->vendor_ramdisk_size);
+        uint64_t vendor_ramdisk_offset = offset;
+        offset += pages(info->vendor_ramdisk_size, page_size) * page_size;
+        add_section(sections, &count, SECTION_DTB, "dtb", offset, info->dtb_size);
+        if (info->header_version > 3) {
+            add_section(sections, &count, SECTION_VENDOR_RAMDISK_TABLE, "vendor_ramdisk_table", info->magic_offset + info->rdt_offset, info->vendor_ramdisk_table_size);
+            add_section(sections, &count, SECTION_BOOTCONFIG, "bootconfig", info->magic_offset + info->bc_offset, info->bootconfig_size);
+
+            // each vendor ramdisk table entry is a fragment of the vendor ramdisk section
+            fseek(f, info->magic_offset + info->rdt_offset, SEEK_SET);
+            uint32_t rdt_entry_cur;
+            uint32_t rdt_entry_num = rdt_entry_count(info);
+            for (rdt_entry_cur = 1; rdt_entry_cur <= rdt_entry_num && count < MAX_SECTIONS; rdt_entry_cur++) {
+                vendor_ramdisk_table_entry_v4 rdt_entry;
+                read_rdt_entry(f, info, &rdt_entry);
+                // named by index like unpack_bootimg, the image supplied ramdisk_name only becomes the label
+                char name[sizeof(sections[0].name)];
+                snprintf(name, sizeof(name), "vendor_ramdisk%02u", rdt_entry_cur - 1);
+                add_section(sections, &count, SECTION_VENDOR_RAMDISK_FRAGMENT, name, vendor_ramdisk_offset + rdt_entry.ramdisk_offset, rdt_entry.ramdisk_size);
+                char *label = sections[count - 1].label;
+                int c;
+                for (c = 0; c < VENDOR_RAMDISK_NAME_SIZE && rdt_entry.ramdisk_name[c]; c++) {
+                    char ch = rdt_entry.ramdisk_name[c];
+                    label[c] = (ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || (ch >= '0' && ch <= '9') || ch == '-' || ch == '.' ? ch : '_';
+                }
+                label[c] = '\0';
+            }
+        }
+    }
+    return count;
+}
+
+// MTK headers prepended to the kernel or ramdisks, and the Samsung trailer following the last section
+void find_section_wrappers(FILE *f, img_info *info)
+{
+    img_section sections[MAX_SECTIONS];
+    int count = read_sections(f, info, sections);
+    uint64_t end = 0;
+    uint64_t checked = 0;
+    uint8_t buf[SEANDROID_MAGIC_SIZE + 32];
+    int n;
+    for (n = 0; n < count; n++) {
+        img_section *section = &sections[n];
+        uint64_t section_end = section->offset + (uint64_t)pages(section->size, info->page_size) * info->page_size;
+        if (section_end > end) {
+            end = section_end;
+        }
+        if (section->kind != SECTION_KERNEL && section->kind != SECTION_RAMDISK
+            && section->kind != SECTION_VENDOR_RAMDISK && section->kind != SECTION_VENDOR_RAMDISK_FRAGMENT) {
+            continue;
+        }
+        if (section->size < 8 + 32 || section->offset == checked) {
+            continue;
+        }
+        checked = section->offset;
+        fseek(f, section->offset, SEEK_SET);
+        if (fread(buf, 8 + 32, 1, f) && !memcmp(buf, MTK_MAGIC, MTK_MAGIC_SIZE)) {
+            decode_mtk_header(buf, section->offset);
+        }
+    }
+    fseek(f, end, SEEK_SET);
+    if (fread(buf, SEANDROID_MAGIC_SIZE, 1, f) && !memcmp(buf, SEANDROID_MAGIC, SEANDROID_MAGIC_SIZE)) {
+        add_wrapper("SEANDROIDENFORCE trailer", end, "");
+    }
+}
+
+void print_wrappers()
+{
+    printf(" wrappers:\n");
+    int n;
+    for (n = 0; n < wrapper_count; n++) {
+        printf("  %-31s : %-10d  (%08x)%s%s\n", wrappers[n].name, wrappers[n].offset, wrappers[n].offset,
+            wrappers[n].detail[0] ? ": " : "", wrappers[n].detail);
+    }
+}
+
+#ifdef __linux__
+// copy_file_range shares extents (reflinks) on CoW filesystems; sendfile and read/write are the fallbacks
+int copy_range(int in, uint64_t offset, uint64_t size, int out)
+{
+    off_t in_off = offset;
+    while (size > 0) {
+        ssize_t len = copy_file_range(in, &in_off, out, NULL, size, 0);
+        if (len <= 0) {
+            break;
+        }
+        size -= len;
+    }
+    while (size > 0) {
+        ssize_t len = sendfile(out, in, &in_off, size);
+        if (len <= 0) {
+            break;
+        }
+        size -= len;
+    }
+    char buf[65536];
+    while (size > 0) {
+        ssize_t len = pread(in, buf, size < sizeof(buf) ? size : sizeof(buf), in_off);
+        if (len <= 0 || write(out, buf, len) != len) {
+            return -1;
+        }
+        in_off += len;
+        size -= len;
+    }
+    return 0;
+}
+
+int extract_section(char *filename, img_section *section, char *outname)
+{
+    int in = open(filename, O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return -1;
+    }
+    int out = open(outname, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (out < 0) {
+        close(in);
+        return -1;
+    }
+    int ret = copy_range(in, section->offset, section->size, out);
+    close(in);
+    if (close(out)) {
+        ret = -1;
+    }
+    return ret;
+}
+#else
+int extract_section(char *filename, img_section *section, char *outname)
+{
+    FILE *in = fopen(filename, "rb");
+    if (!in) {
+        return -1;
+    }
+    FILE *out = fopen(outname, "wb");
+    if (!out) {
+        fclose(in);
+        return -1;
+    }
+    fseek(in, section->offset, SEEK_SET);
+    char buf[65536];
+    uint64_t size = section->size;
+    int ret = 0;
+    while (size > 0) {
+        size_t len = fread(buf, 1, size < sizeof(buf) ? size : sizeof(buf), in);
+        if (len == 0 || fwrite(buf, 1, len, out) != len) {
+            ret = -1;
+            break;
+        }
+        size -= len;
+    }
+    fclose(in);
+    if (fclose(out)) {
+        ret = -1;
+    }
+    return ret;
+}
+#endif
+
+// match a name against the comma separated selection
+int selected(char *selection, char *name)
+{
+    size_t len = strlen(name);
+    char *p = selection;
+    while ((p = strstr(p, name)) != NULL) {
+        if ((p == selection || p[-1] == ',') && (p[len] == ',' || p[len] == '\0')) {
+            return 1;
+        }
+        p += len;
+    }
+    return 0;
+}
+
+// match a section by name, or a fragment as vendor_ramdisk:<label>, against the selection
+int section_selected(char *selection, img_section *section)
+{
+    char labelled[sizeof(section->label) + 16];
+    snprintf(labelled, sizeof(labelled), "vendor_ramdisk:%s", section->label);
+    return selected(selection, section->name)
+        || (section->kind == SECTION_VENDOR_RAMDISK_FRAGMENT && section->label[0] && selected(selection, labelled));
+}
+
+int extract_sections(char *filename, char *selection, char *directory)
+{
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        printf("bootimg-info: File not found!\n");
+        return 1;
+    }
+    img_info info;
+    if (read_img_info(f, &info) < 0) {
+        printf("bootimg-info: No boot image magic found!\n");
+        fclose(f);
+        return 1;
+    }
+    img_section sections[MAX_SECTIONS];
+    int count = read_sections(f, &info, sections);
+    fclose(f);
+
+    char *basename = strrchr(filename, '/');
+    basename = basename ? basename + 1 : filename;
+
+    int ret = 0;
+    int n;
+    if (strcmp(selection, "all")) {
+        // every requested name has to exist in this image before anything is written
+        char *token = selection;
+        while (token) {
+            char *next = strchr(token, ',');
+            char name[sizeof(sections[0].label) + 16];
+            snprintf(name, sizeof(name), "%.*s", next ? (int)(next - token) : (int)strlen(token), token);
+            for (n = 0; n < count && !section_selected(name, &sections[n]); n++);
+            if (n == count) {
+                printf("bootimg-info: No section \"%s\" in this image!\n", name);
+                ret = 1;
+            }
+            token = next ? next + 1 : NULL;
+        }
+        if (ret) {
+            return 1;
+        }
+    }
+    for (n = 0; n < count; n++) {
+        img_section *section = &sections[n];
+        if (strcmp(selection, "all") && !section_selected(selection, section)) {
+            continue;
+        }
+        if (section->size == 0) {
+            continue;
+        }
+        if (section->offset + section->size > info.file_size) {
+            printf("bootimg-info: Section %s extends past end of file!\n", section->name);
+            ret = 1;
+            continue;
+        }
+
+        char outname[PATH_MAX];
+        snprintf(outname, sizeof(outname), "%s/%s-%s", directory, basename, section->name);
+        if (extract_section(filename, section, outname) < 0) {
+            printf("bootimg-info: Could not write \"%s\"!\n", outname);
+            ret = 1;
+            continue;
+        }
+        char display[sizeof(section->name) + sizeof(section->label) + 4];
+        if (section->label[0]) {
+            snprintf(display, sizeof(display), "%s (%s)", section->name, section->label);
+        } else {
+            snprintf(display, sizeof(display), "%s", section->name);
+        }
+        printf("  %-31s : %-10"PRIu64"  (%08"PRIx64") -> %s\n", display, section->size, section->size, outname);
+    }
+    return ret;
+}
+
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+uint64_t xxh_rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+uint64_t xxh_read64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint64_t xxh64_round(uint64_t acc, uint64_t input)
+{
+    acc += input * XXH_PRIME64_2;
+    acc = xxh_rotl64(acc, 31);
+    return acc * XXH_PRIME64_1;
+}
+
+uint64_t xxh64_merge_round(uint64_t acc, uint64_t val)
+{
+    acc ^= xxh64_round(0, val);
+    return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+// XXH64, the portable 64-bit xxHash (little-endian hosts, like the header parsing)
+uint64_t xxh64(const uint8_t *p, size_t len, uint64_t seed)
+{
+    const uint8_t *end = p + len;
+    uint64_t h;
+    if (len >= 32) {
+        uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+        uint64_t v2 = seed + XXH_PRIME64_2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - XXH_PRIME64_1;
+        do {
+            v1 = xxh64_round(v1, xxh_read64(p));
+            v2 = xxh64_round(v2, xxh_read64(p + 8));
+            v3 = xxh64_round(v3, xxh_read64(p + 16));
+            v4 = xxh64_round(v4, xxh_read64(p + 24));
+            p += 32;
+        } while (p + 32 <= end);
+        h = xxh_rotl64(v1, 1) + xxh_rotl64(v2, 7) + xxh_rotl64(v3, 12) + xxh_rotl64(v4, 18);
+        h = xxh64_merge_round(h, v1);
+        h = xxh64_merge_round(h, v2);
+        h = xxh64_merge_round(h, v3);
+        h = xxh64_merge_round(h, v4);
+    } else {
+        h = seed + XXH_PRIME64_5;
+    }
+    h += len;
+    while (p + 8 <= end) {
+        h ^= xxh64_round(0, xxh_read64(p));
+        h = xxh_rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        uint32_t v;
+        memcpy(&v, p, sizeof(v));
+        h ^= (uint64_t)v * XXH_PRIME64_1;
+        h = xxh_rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+    }
+    while (p < end) {
+        h ^= *p * XXH_PRIME64_5;
+        h = xxh_rotl64(h, 11) * XXH_PRIME64_1;
+        p++;
+    }
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+#define FP_SAMPLES 16 // samples per section, evenly spread from its first to its last byte
+#define FP_SAMPLE_SIZE 4096
+#define FP_CHUNK_SIZE (1024 * 1024)
+
+// hash size bytes at offset, chained onto h; the chaining makes the result differ from a plain XXH64 of the same data
+uint64_t fingerprint_range(FILE *f, uint64_t offset, uint64_t size, uint8_t *buf, size_t buf_size, uint64_t h)
+{
+    fseek(f, offset, SEEK_SET);
+    while (size > 0) {
+        size_t len = fread(buf, 1, size < buf_size ? size : buf_size, f);
+        if (len == 0) {
+            break;
+        }
+        h = xxh64(buf, len, h);
+        size -= len;
+    }
+    return h;
+}
+
+// the header page plus FP_SAMPLES fixed-size samples of every section, so identity checks read a few hundred KB at most
+uint64_t fingerprint_sampled(FILE *f, img_info *info)
+{
+    img_section sections[MAX_SECTIONS];
+    int count = read_sections(f, info, sections);
+    uint8_t buf[FP_SAMPLE_SIZE];
+    uint64_t h = xxh64((uint8_t *)&info->file_size, sizeof(info->file_size), 0);
+    int n, k;
+    for (n = 0; n < count; n++) {
+        img_section *section = &sections[n];
+        h = xxh64((uint8_t *)&section->size, sizeof(section->size), h);
+        if (section->size <= FP_SAMPLES * FP_SAMPLE_SIZE) {
+            h = fingerprint_range(f, section->offset, section->size, buf, sizeof(buf), h);
+            continue;
+        }
+        for (k = 0; k < FP_SAMPLES; k++) {
+            uint64_t offset = (section->size - FP_SAMPLE_SIZE) * k / (FP_SAMPLES - 1);
+            h = fingerprint_range(f, section->offset + offset, FP_SAMPLE_SIZE, buf, sizeof(buf), h);
+        }
+    }
+    return h;
+}
+
+uint64_t fingerprint_full(FILE *f, img_info *info)
+{
+    uint8_t *buf = malloc(FP_CHUNK_SIZE);
+    if (!buf) {
+        printf("bootimg-info: Out of memory!\n");
+        exit(1);
+    }
+    uint64_t h = fingerprint_range(f, 0, info->file_size, buf, FP_CHUNK_SIZE, 0);
+    free(buf);
+    return h;
+}
+
+int fingerprint_image(char *filename, char *expected, int full)
+{
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        printf("bootimg-info: File not found!\n");
+        return 1;
+    }
+    img_info info;
+    if (read_img_info(f, &info) < 0) {
+        printf("bootimg-info: No boot image magic found!\n");
+        fclose(f);
+        return 1;
+    }
+    uint64_t sampled = fingerprint_sampled(f, &info);
+
+    if (!expected) {
+        printf("%016"PRIx64, sampled);
+        if (full) {
+            printf(":%016"PRIx64, fingerprint_full(f, &info));
+        }
+        printf("  %s\n", filename);
+        fclose(f);
+        return 0;
+    }
+
+    // expected is "sampled" or "sampled:full"; a sampled mismatch is conclusive, a sampled match is
+    // only escalated to the full hash when asked for and the full hash is known
+    char *colon = strchr(expected, ':');
+    int ret = strtoull(expected, NULL, 16) != sampled;
+    if (!ret && full && colon) {
+        ret = strtoull(colon + 1, NULL, 16) != fingerprint_full(f, &info);
+    }
+    printf("%s  %s\n", ret ? "mismatch" : "match", filename);
+    fclose(f);
+    return ret;
+}
+
+#define AUDIT_BLOCK_SIZE 65536 // entropy histogram granularity
+#define AUDIT_BINS 8 // one bin per bit of entropy per byte
+#define AVB_FOOTER_MAGIC "AVBf"
+#define AVB_FOOTER_SIZE 64
+
+enum { REGION_DATA, REGION_PADDING, REGION_OTHER };
+
+typedef struct {
+    char *name;
+    int kind;
+    uint64_t offset;
+    uint64_t size;
+    uint64_t counts[256];
+    uint32_t blocks[AUDIT_BINS];
+} audit_region;
+
+// four interleaved count tables keep consecutive equal bytes from serializing on one counter
+void byte_histogram(const uint8_t *p, size_t len, uint64_t *counts)
+{
+    uint32_t c[4][256];
+    memset(c, 0, sizeof(c));
+    size_t n = 0;
+    for (; n + 4 <= len; n += 4) {
+        uint32_t v;
+        memcpy(&v, p + n, sizeof(v));
+        c[0][v & 0xff]++;
+        c[1][(v >> 8) & 0xff]++;
+        c[2][(v >> 16) & 0xff]++;
+        c[3][v >> 24]++;
+    }
+    for (; n < len; n++) {
+        c[0][p[n]]++;
+    }
+    int b;
+    for (b = 0; b < 256; b++) {
+        counts[b] += c[0][b] + c[1][b] + c[2][b] + c[3][b];
+    }
+}
+
+double shannon_entropy(uint64_t *counts, uint64_t total)
+{
+    double entropy = 0;
+    int b;
+    for (b = 0; b < 256 && total; b++) {
+        if (counts[b]) {
+            double p = (double)counts[b] / total;
+            entropy -= p * log2(p);
+        }
+    }
+    return entropy;
+}
+
+void add_region(audit_region *regions, int *count, char *name, int kind, uint64_t offset, uint64_t size)
+{
+    if (size == 0 || *count >= MAX_SECTIONS * 2 + 2) {
+        return;
+    }
+    memset(&regions[*count], 0, sizeof(regions[*count]));
+    regions[*count].name = name;
+    regions[*count].kind = kind;
+    regions[*count].offset = offset;
+    regions[*count].size = size;
+    (*count)++;
+}
+
+int audit_image(char *filename)
+{
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        printf("bootimg-info: File not found!\n");
+        return 1;
+    }
+    img_info info;
+    if (read_img_info(f, &info) < 0) {
+        printf("bootimg-info: No boot image magic found!\n");
+        fclose(f);
+        return 1;
+    }
+    img_section sections[MAX_SECTIONS];
+    int count = read_sections(f, &info, sections);
+    find_section_wrappers(f, &info);
+
+    printf(" Android Boot Image Info Utility\n\n");
+
+    printf(" Auditing layout of \"%s\":\n\n", filename);
+
+    int problems = 0;
+    if (info.page_size == 0 || (info.page_size & (info.page_size - 1))) {
+        printf("  problem                         : page_size %u is not a power of two\n", info.page_size);
+        problems++;
+    }
+
+    // split the file into consecutive regions: section data, its page padding, and anything outside the sections
+    static audit_region regions[MAX_SECTIONS * 2 + 2];
+    int region_count = 0;
+    uint64_t pos = 0;
+    uint64_t vendor_ramdisk_offset = 0, vendor_ramdisk_size = 0;
+    int n;
+    for (n = 0; n < count; n++) {
+        img_section *section = &sections[n];
+        uint64_t end = section->offset + section->size;
+        uint64_t padded_end = section->offset + (uint64_t)pages(section->size, info.page_size) * info.page_size;
+        if (section->kind == SECTION_VENDOR_RAMDISK) {
+            vendor_ramdisk_offset = section->offset;
+            vendor_ramdisk_size = section->size;
+        }
+        if (section->kind == SECTION_VENDOR_RAMDISK_FRAGMENT) {
+            // fragments only need to stay inside the vendor ramdisk section
+            if (section->offset < vendor_ramdisk_offset || end > vendor_ramdisk_offset + vendor_ramdisk_size) {
+                printf("  problem                         : %s lies outside vendor_ramdisk\n", section->name);
+                problems++;
+            }
+            continue;
+        }
+        if (end > info.file_size) {
+            printf("  problem                         : %s extends %"PRIu64" bytes past end of file\n", section->name, end - info.file_size);
+            problems++;
+        }
+        if (section->size && section->offset < pos) {
+            printf("  problem                         : %s overlaps the previous section by %"PRIu64" bytes\n", section->name, pos - section->offset);
+            problems++;
+        }
+        if (section->offset > pos) {
+            add_region(regions, &region_count, pos == 0 ? "prefix" : "gap", REGION_OTHER, pos, section->offset - pos);
+            pos = section->offset;
+        }
+        if (end > pos) {
+            add_region(regions, &region_count, section->name, REGION_DATA, pos, end - pos);
+            pos = end;
+        }
+        if (padded_end > pos) {
+            add_region(regions, &region_count, section->name, REGION_PADDING, pos, padded_end - pos);
+            pos = padded_end;
+        }
+    }
+    if (!strcmp(info.magic, BOOT_MAGIC) && info.header_version > 0 && info.header_version < 3 && info.recovery_dtbo_size) {
+        for (n = 0; n < count && sections[n].kind != SECTION_RECOVERY_DTBO; n++);
+        if (n < count && info.recovery_dtbo_offset != sections[n].offset - info.magic_offset) {
+            printf("  problem                         : recovery_dtbo_offset %"PRIu64" does not match layout offset %"PRIu64"\n",
+                info.recovery_dtbo_offset, sections[n].offset - info.magic_offset);
+            problems++;
+        }
+    }
+    uint64_t trailing_offset = pos;
+    if (info.file_size > pos) {
+        add_region(regions, &region_count, "trailing", REGION_OTHER, pos, info.file_size - pos);
+    }
+
+    // one sequential pass over the file, histogramming every block of every region
+    uint8_t *buf = malloc(AUDIT_BLOCK_SIZE);
+    if (!buf) {
+        printf("bootimg-info: Out of memory!\n");
+        fclose(f);
+        return 1;
+    }
+    fseek(f, 0, SEEK_SET);
+    int r;
+    for (r = 0; r < region_count; r++) {
+        audit_region *region = &regions[r];
+        if (region->offset + region->size > info.file_size) {
+            region->size = region->offset < info.file_size ? info.file_size - region->offset : 0;
+        }
+        uint64_t left = region->size;
+        while (left > 0) {
+            size_t len = fread(buf, 1, left < AUDIT_BLOCK_SIZE ? left : AUDIT_BLOCK_SIZE, f);
+            if (len == 0) {
+                break;
+            }
+            uint64_t block[256];
+            memset(block, 0, sizeof(block));
+            byte_histogram(buf, len, block);
+            int bin = shannon_entropy(block, len);
+            region->blocks[bin < AUDIT_BINS ? bin : AUDIT_BINS - 1]++;
+            int b;
+            for (b = 0; b < 256; b++) {
+                region->counts[b] += block[b];
+            }
+            left -= len;
+        }
+        region->size -= left;
+    }
+
+    uint64_t padding_total = 0;
+    for (r = 0; r < region_count; r++) {
+        audit_region *region = &regions[r];
+        if (region->kind == REGION_PADDING) {
+            padding_total += region->size;
+            if (region->counts[0] != region->size) {
+                printf("  problem                         : %s padding holds %"PRIu64" non-zero bytes\n", region->name, region->size - region->counts[0]);
+                problems++;
+            }
+            continue;
+        }
+        // a recognized wrapper header accounts for the data before the magic
+        if (region->kind == REGION_OTHER && !strcmp(region->name, "prefix") && wrapper_count && wrappers[0].offset < info.magic_offset) {
+            continue;
+        }
+        if (region->kind == REGION_OTHER && strcmp(region->name, "trailing") && region->counts[0] != region->size) {
+            printf("  problem                         : %"PRIu64" bytes of unexpected data in %s at %"PRIu64"\n", region->size, region->name, region->offset);
+            problems++;
+        }
+    }
+    if (problems) {
+        printf("\n");
+    }
+
+    for (r = 0; r < region_count; r++) {
+        audit_region *region = &regions[r];
+        if (region->kind == REGION_PADDING) {
+            continue;
+        }
+        printf(" %s:\n", region->name);
+        printf("  offset                          : %-10"PRIu64"  (%08"PRIx64")\n", region->offset, region->offset);
+        printf("  size                            : %-10"PRIu64"  (%08"PRIx64")\n", region->size, region->size);
+        if (r + 1 < region_count && regions[r + 1].kind == REGION_PADDING) {
+            printf("  padding                         : %-10"PRIu64"  (%08"PRIx64")\n", regions[r + 1].size, regions[r + 1].size);
+        }
+        printf("  entropy                         : %.3f bits/byte\n", shannon_entropy(region->counts, region->size));
+        printf("  entropy histogram               :");
+        int bin;
+        for (bin = 0; bin < AUDIT_BINS; bin++) {
+            printf(" %u", region->blocks[bin]);
+        }
+        printf("  (%d KiB blocks per bit/byte)\n\n", AUDIT_BLOCK_SIZE / 1024);
+    }
 
-        y = (os_patch_level >> 4) + 2000;
-        m = os_patch_level&0xf;
+    if (wrapper_count) {
+        print_wrappers();
+        printf("\n");
     }
-    if ((a < 128) && (b < 128) && (c < 128) && (y >= 2000) && (y < 2128) && (m > 0) && (m <= 12)) {
-        printf("  os_version                      : %d.%d.%-5d  (%08x)\n", a, b, c, hdr_os_ver);
-        printf("  (os_patch_level)                : %d-%02d\n", y, m);
-    } else {
-        printf("  unused                          : %-10d  (%08x)\n", hdr_os_ver, hdr_os_ver);
+
+    printf(" Other:\n");
+    printf("  file size                       : %-10"PRIu64"  (%08"PRIx64")\n", info.file_size, info.file_size);
+    printf("  padding                         : %-10"PRIu64"  (%08"PRIx64")\n", padding_total, padding_total);
+    if (info.file_size > trailing_offset) {
+        uint64_t trailing_size = info.file_size - trailing_offset;
+        char *trailing_type = "unknown";
+        uint8_t tmp[SEANDROID_MAGIC_SIZE];
+        fseek(f, trailing_offset, SEEK_SET);
+        if (fread(tmp, SEANDROID_MAGIC_SIZE, 1, f) && !memcmp(tmp, SEANDROID_MAGIC, SEANDROID_MAGIC_SIZE)) {
+            trailing_type = "SEANDROIDENFORCE";
+        }
+        if (trailing_size >= AVB_FOOTER_SIZE) {
+            fseek(f, info.file_size - AVB_FOOTER_SIZE, SEEK_SET);
+            if (fread(tmp, 4, 1, f) && !memcmp(tmp, AVB_FOOTER_MAGIC, 4)) {
+                trailing_type = "AVB footer";
+            }
+        }
+        if (regions[region_count - 1].counts[0] == trailing_size) {
+            trailing_type = "zero";
+        }
+        printf("  trailing data                   : %-10"PRIu64"  (%08"PRIx64"): %s\n", trailing_size, trailing_size, trailing_type);
     }
+    printf("  problems                        : %d\n\n", problems);
+
+    free(buf);
+    fclose(f);
+    return problems ? 1 : 0;
 }
 
-void print_id(boot_img_hdr_v2 *hdr)
+int patch_write(FILE *f, long offset, const void *p, size_t n)
 {
-    int SHA256_DIGEST_SIZE = 32;
-    uint8_t id[SHA256_DIGEST_SIZE];
-    memcpy(&id, hdr->id, sizeof(id));
-    printf("  id                              : ");
-    int i;
-    for (i = 0; i < SHA256_DIGEST_SIZE; ++i) {
-        printf("%02hhx", id[i]);
-    }
-    printf("\n\n");
+    fseek(f, offset, SEEK_SET);
+    return fwrite(p, 1, n, f) == n ? 0 : -1;
 }
 
-int main(int argc, char** argv)
+int patch_image(char *filename, int argc, char **argv)
 {
-    char *filename = NULL;
-    argc--;
-    if (argc > 0) {
+    char *cmdline = NULL;
+    char *os_version = NULL;
+    char *os_patch_level = NULL;
+    char *bootconfig = NULL;
+    while (argc >= 2) {
+        char *arg = argv[0];
         char *val = argv[1];
-        filename = val;
+        argc -= 2;
+        argv += 2;
+        if (!strcmp(arg, "--cmdline")) {
+            cmdline = val;
+        } else if (!strcmp(arg, "--os_version")) {
+            os_version = val;
+        } else if (!strcmp(arg, "--os_patch_level")) {
+            os_patch_level = val;
+        } else if (!strcmp(arg, "--bootconfig")) {
+            bootconfig = val;
+        } else {
+            return usage();
+        }
     }
-    if (filename == NULL) {
+    if (argc > 0 || (!cmdline && !os_version && !os_patch_level && !bootconfig)) {
         return usage();
     }
-    FILE *f = fopen(filename, "rb");
+
+    FILE *f = fopen(filename, "r+b");
     if (!f) {
         printf("bootimg-info: File not found!\n");
         return 1;
     }
+    img_info info;
+    if (read_img_info(f, &info) < 0) {
+        printf("bootimg-info: No boot image magic found!\n");
+        fclose(f);
+        return 1;
+    }
+    int is_boot = !strcmp(info.magic, BOOT_MAGIC);
+
+    // validate everything first so a rejected option leaves the image untouched
+    size_t cmdline_max = !is_boot ? VENDOR_BOOT_ARGS_SIZE : BOOT_ARGS_SIZE + BOOT_EXTRA_ARGS_SIZE;
+    if (cmdline && strlen(cmdline) > cmdline_max - (info.header_version < 3 ? 2 : 1)) {
+        printf("bootimg-info: cmdline too long!\n");
+        fclose(f);
+        return 1;
+    }
+    int a, b, c, y, m;
+    if ((os_version || os_patch_level) && !is_boot) {
+        printf("bootimg-info: vendor_boot has no os_version!\n");
+        fclose(f);
+        return 1;
+    }
+    if (os_version && (sscanf(os_version, "%d.%d.%d", &a, &b, &c) != 3 || a < 0 || a > 127 || b < 0 || b > 127 || c < 0 || c > 127)) {
+        printf("bootimg-info: Invalid os_version!\n");
+        fclose(f);
+        return 1;
+    }
+    if (os_patch_level && (sscanf(os_patch_level, "%d-%d", &y, &m) != 2 || y < 2000 || y > 2127 || m < 1 || m > 12)) {
+        printf("bootimg-info: Invalid os_patch_level!\n");
+        fclose(f);
+        return 1;
+    }
+    char *bc_data = NULL;
+    uint32_t bc_size = 0;
+    if (bootconfig) {
+        if (is_boot || info.header_version < 4) {
+            printf("bootimg-info: bootconfig requires a vendor_boot v4 image!\n");
+            fclose(f);
+            return 1;
+        }
+        FILE *bc = fopen(bootconfig, "rb");
+        if (!bc) {
+            printf("bootimg-info: File not found!\n");
+            fclose(f);
+            return 1;
+        }
+        fseek(bc, 0, SEEK_END);
+        bc_size = ftell(bc);
+        fseek(bc, 0, SEEK_SET);
+        // zero padded to the end of its last page, the same layout mkbootimg writes
+        size_t bc_padded = pages(bc_size, info.page_size) * info.page_size;
+        bc_data = calloc(1, bc_padded ? bc_padded : 1);
+        if (!bc_data || (bc_size && !fread(bc_data, bc_size, 1, bc))) {
+            printf("bootimg-info: Could not read \"%s\"!\n", bootconfig);
+            fclose(bc);
+            fclose(f);
+            free(bc_data);
+            return 1;
+        }
+        fclose(bc);
 
-    char tmp[BOOT_MAGIC_SIZE];
-    char *magic = NULL;
+        // bootconfig is the last section, so it may only change its page count when nothing follows it
+        uint64_t bc_end = info.magic_offset + info.bc_offset + pages(info.bootconfig_size, info.page_size) * info.page_size;
+        if (pages(bc_size, info.page_size) != pages(info.bootconfig_size, info.page_size) && info.file_size != bc_end) {
+            printf("bootimg-info: Data follows bootconfig, new bootconfig must fit in %d page(s)!\n", pages(info.bootconfig_size, info.page_size));
+            fclose(f);
+            free(bc_data);
+            return 1;
+        }
+    }
 
-    int i;
-    int seeklimit = 65536; // arbitrary byte limit to search in input file for boot image magic
-    for (i = 0; i <= seeklimit; i++) {
-        fseek(f, i, SEEK_SET);
-        if(fread(tmp, BOOT_MAGIC_SIZE, 1, f)){};
-        if (memcmp(tmp, BOOT_MAGIC, BOOT_MAGIC_SIZE) == 0) {
-            magic = BOOT_MAGIC;
-            break;
+    int ret = 0;
+    if (cmdline) {
+        char buf[VENDOR_BOOT_ARGS_SIZE];
+        memset(buf, 0, sizeof(buf));
+        memcpy(buf, cmdline, strlen(cmdline));
+        if (!is_boot) {
+            ret |= patch_write(f, info.magic_offset + offsetof(vendor_boot_img_hdr_v4, cmdline), buf, VENDOR_BOOT_ARGS_SIZE);
+        } else if (info.header_version < 3) {
+            // split like mkbootimg: the first BOOT_ARGS_SIZE - 1 bytes in cmdline, the rest in extra_cmdline
+            char extra[BOOT_EXTRA_ARGS_SIZE];
+            memset(extra, 0, sizeof(extra));
+            memcpy(extra, buf + BOOT_ARGS_SIZE - 1, BOOT_EXTRA_ARGS_SIZE - 1);
+            buf[BOOT_ARGS_SIZE - 1] = '\0';
+            ret |= patch_write(f, info.magic_offset + offsetof(boot_img_hdr_v2, cmdline), buf, BOOT_ARGS_SIZE);
+            ret |= patch_write(f, info.magic_offset + offsetof(boot_img_hdr_v2, extra_cmdline), extra, BOOT_EXTRA_ARGS_SIZE);
+        } else {
+            ret |= patch_write(f, info.magic_offset + offsetof(boot_img_hdr_v4, cmdline), buf, BOOT_ARGS_SIZE + BOOT_EXTRA_ARGS_SIZE);
         }
-        if (memcmp(tmp, VENDOR_BOOT_MAGIC, VENDOR_BOOT_MAGIC_SIZE) == 0) {
-            magic = VENDOR_BOOT_MAGIC;
-            break;
+        printf("  cmdline                         : %s\n", cmdline);
+    }
+    if (os_version || os_patch_level) {
+        // same bit layout print_os_version() decodes, keeping whichever half was not given
+        uint32_t hdr_os_ver = info.os_version;
+        if (os_version) {
+            hdr_os_ver = (((a << 14) | (b << 7) | c) << 11) | (hdr_os_ver & 0x7ff);
+        }
+        if (os_patch_level) {
+            hdr_os_ver = (hdr_os_ver & ~0x7ff) | ((y - 2000) << 4) | m;
         }
+        long offset = info.header_version < 3 ? offsetof(boot_img_hdr_v2, os_version) : offsetof(boot_img_hdr_v4, os_version);
+        ret |= patch_write(f, info.magic_offset + offset, &hdr_os_ver, sizeof(hdr_os_ver));
+        print_os_version(hdr_os_ver);
     }
-    if (i > seeklimit) {
-        printf("bootimg-info: No boot image magic found!\n");
+    if (bootconfig) {
+        uint32_t old_pages = pages(info.bootconfig_size, info.page_size);
+        ret |= patch_write(f, info.magic_offset + info.bc_offset, bc_data, pages(bc_size, info.page_size) * info.page_size);
+        ret |= patch_write(f, info.magic_offset + offsetof(vendor_boot_img_hdr_v4, bootconfig_size), &bc_size, sizeof(bc_size));
+        if (pages(bc_size, info.page_size) < old_pages) {
+            fflush(f);
+            if (ftruncate(fileno(f), info.magic_offset + info.bc_offset + pages(bc_size, info.page_size) * info.page_size)) {
+                ret = 1;
+            }
+        }
+        printf("  bootconfig_size                 : %-10d  (%08x)\n", bc_size, bc_size);
+        free(bc_data);
+    }
+
+    // the v0-v2 id digest only covers section contents and sizes, so header edits never invalidate it
+    if (fclose(f) || ret) {
+        printf("bootimg-info: Write failed!\n");
         return 1;
     }
+    return 0;
+}
 
-    printf(" Android Boot Image Info Utility\n\n");
+/*
+ * Columnar export file layout, integers in host (little-endian) byte order:
+ *
+ *   "BOOTICOL"                        file magic
+ *   uint32 format version             currently 1
+ *   uint32 table count
+ *   per table:  string name, uint32 column count,
+ *               per column: uint8 type (1 = u32, 2 = u64, 3 = string), string name
+ *   batches:    uint32 table index, uint32 row count,
+ *               per column: uint64 byte length, then the column data
+ *                 u32/u64: row count values
+ *                 string:  row count + 1 uint32 offsets into the bytes that follow
+ *   uint32 0xffffffff                 end of file
+ *
+ *   string = uint32 length, bytes without terminator
+ *
+ * Rows are buffered per column and written out every EXPORT_BATCH_ROWS rows, so
+ * memory use stays bounded however many images are exported.
+ */
+#define EXPORT_MAGIC "BOOTICOL"
+#define EXPORT_VERSION 1
+#define EXPORT_BATCH_ROWS 4096
+#define EXPORT_END 0xffffffff
 
-    printf(" Printing information for \"%s\":\n\n", filename);
+enum { COL_U32 = 1, COL_U64 = 2, COL_STR = 3 };
 
-    printf(" header:\n");
+typedef struct {
+    char *name;
+    int type;
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+    uint32_t *offsets;
+} export_col;
 
-    boot_img_hdr_v4 header;
-    fseek(f, i, SEEK_SET);
-    if(fread(&header, sizeof(header), 1, f)){};
+typedef struct {
+    char *name;
+    export_col *cols;
+    int ncols;
+    int cur;
+    uint32_t rows;
+} export_table;
 
-    int hdr_ver_max = 8; // arbitrary maximum header version value; when greater assume the field is appended dt size
+// column order is the order values are appended in export_image()
+export_col img_cols[] = {
+    { "path", COL_STR },
+    { "magic", COL_STR },
+    { "magic_offset", COL_U32 },
+    { "header_version", COL_U32 },
+    { "dt_size", COL_U32 },
+    { "page_size", COL_U32 },
+    { "kernel_size", COL_U32 },
+    { "kernel_addr", COL_U32 },
+    { "ramdisk_size", COL_U32 },
+    { "ramdisk_addr", COL_U32 },
+    { "second_size", COL_U32 },
+    { "second_addr", COL_U32 },
+    { "tags_addr", COL_U32 },
+    { "os_version", COL_U32 },
+    { "os_version_str", COL_STR },
+    { "os_patch_level", COL_STR },
+    { "name", COL_STR },
+    { "cmdline", COL_STR },
+    { "extra_cmdline", COL_STR },
+    { "id", COL_STR },
+    { "recovery_dtbo_size", COL_U32 },
+    { "recovery_dtbo_offset", COL_U64 },
+    { "header_size", COL_U32 },
+    { "dtb_size", COL_U32 },
+    { "dtb_addr", COL_U64 },
+    { "signature_size", COL_U32 },
+    { "vendor_ramdisk_size", COL_U32 },
+    { "vendor_ramdisk_table_size", COL_U32 },
+    { "vendor_ramdisk_table_entry_num", COL_U32 },
+    { "vendor_ramdisk_table_entry_size", COL_U32 },
+    { "bootconfig_size", COL_U32 },
+    { "base", COL_U32 },
+    { "kernel_offset", COL_U32 },
+    { "ramdisk_offset", COL_U32 },
+    { "second_offset", COL_U32 },
+    { "tags_offset", COL_U32 },
+    { "dtb_offset", COL_U64 },
+    { "vendor_ramdisk_table_offset", COL_U32 },
+    { "bootconfig_offset", COL_U32 },
+};
 
-    int base = 0;
+export_col rdt_cols[] = {
+    { "image_row", COL_U64 },
+    { "entry", COL_U32 },
+    { "ramdisk_size", COL_U32 },
+    { "ramdisk_offset", COL_U32 },
+    { "ramdisk_type", COL_U32 },
+    { "ramdisk_type_name", COL_STR },
+    { "ramdisk_name", COL_STR },
+    { "board_id", COL_STR },
+};
 
-    if (!strcmp(magic, BOOT_MAGIC)) {
-        if ((header.header_version < 3) || (header.header_version > hdr_ver_max)) {
-            // boot_img_hdr_v2 in the backported header supports all boot_img_hdr versions and cross-compatible variants below 3
+export_table export_tables[] = {
+    { "images", img_cols, sizeof(img_cols) / sizeof(img_cols[0]) },
+    { "vendor_ramdisk_table", rdt_cols, sizeof(rdt_cols) / sizeof(rdt_cols[0]) },
+};
+int export_table_count = sizeof(export_tables) / sizeof(export_tables[0]);
 
-            fseek(f, i, SEEK_SET);
-            boot_img_hdr_v2 header;
-            if(fread(&header, sizeof(header), 1, f)){};
+uint64_t export_image_rows = 0;
+
+void export_write(FILE *out, const void *p, size_t n)
+{
+    if (n && !fwrite(p, n, 1, out)) {
+        printf("bootimg-info: Write failed!\n");
+        exit(1);
+    }
+}
 
-            base = header.kernel_addr - 0x00008000;
+void export_write_u32(FILE *out, uint32_t v)
+{
+    export_write(out, &v, sizeof(v));
+}
+
+void export_write_str(FILE *out, char *s)
+{
+    export_write_u32(out, strlen(s));
+    export_write(out, s, strlen(s));
+}
 
-            printf("  magic                           : ANDROID!\n");
-            printf("  kernel_size                     : %-10d  (%08x)\n", header.kernel_size, header.kernel_size);
-            printf("  kernel_addr                     : 0x%08x\n\n", header.kernel_addr);
+void export_append(export_col *col, const void *p, size_t n)
+{
+    if (col->len + n > col->cap) {
+        size_t cap = col->cap ? col->cap : 4096;
+        while (cap < col->len + n) {
+            cap *= 2;
+        }
+        col->data = realloc(col->data, cap);
+        if (!col->data) {
+            printf("bootimg-info: Out of memory!\n");
+            exit(1);
+        }
+        col->cap = cap;
+    }
+    memcpy(col->data + col->len, p, n);
+    col->len += n;
+}
 
-            printf("  ramdisk_size                    : %-10d  (%08x)\n", header.ramdisk_size, header.ramdisk_size);
-            printf("  ramdisk_addr                    : 0x%08x\n", header.ramdisk_addr);
-            printf("  second_size                     : %-10d  (%08x)\n", header.second_size, header.second_size);
-            printf("  second_addr                     : 0x%08x\n\n", header.second_addr);
+void export_u32(export_table *t, uint32_t v)
+{
+    export_append(&t->cols[t->cur++], &v, sizeof(v));
+}
 
-            printf("  tags_addr                       : 0x%08x\n", header.tags_addr);
-            printf("  page_size                       : %-10d  (%08x)\n", header.page_size, header.page_size);
-            if (header.dt_size > hdr_ver_max) {
-                printf("  dt_size                         : %-10d  (%08x)\n", header.dt_size, header.dt_size);
-            } else {
-                printf("  header_version                  : %-10d  (%08x)\n", header.header_version, header.header_version);
-            }
-            print_os_version(header.os_version); printf("\n");
+void export_u64(export_table *t, uint64_t v)
+{
+    export_append(&t->cols[t->cur++], &v, sizeof(v));
+}
 
-            printf("  name                            : %s\n\n", header.name);
+void export_str(export_table *t, char *s, size_t n)
+{
+    export_col *col = &t->cols[t->cur++];
+    if (!col->offsets) {
+        col->offsets = calloc(EXPORT_BATCH_ROWS + 1, sizeof(uint32_t));
+        if (!col->offsets) {
+            printf("bootimg-info: Out of memory!\n");
+            exit(1);
+        }
+    }
+    export_append(col, s, strnlen(s, n));
+    col->offsets[t->rows + 1] = col->len;
+}
+
+void export_flush(FILE *out, int index)
+{
+    export_table *t = &export_tables[index];
+    if (t->rows == 0) {
+        return;
+    }
+    export_write_u32(out, index);
+    export_write_u32(out, t->rows);
+    int c;
+    for (c = 0; c < t->ncols; c++) {
+        export_col *col = &t->cols[c];
+        uint64_t size = col->len;
+        if (col->type == COL_STR) {
+            size += (t->rows + 1) * sizeof(uint32_t);
+        }
+        export_write(out, &size, sizeof(size));
+        if (col->type == COL_STR) {
+            export_write(out, col->offsets, (t->rows + 1) * sizeof(uint32_t));
+        }
+        export_write(out, col->data, col->len);
+        col->len = 0;
+    }
+    t->rows = 0;
+}
+
+void export_row_end(FILE *out, int index)
+{
+    export_table *t = &export_tables[index];
+    t->cur = 0;
+    if (++t->rows == EXPORT_BATCH_ROWS) {
+        export_flush(out, index);
+    }
+}
+
+int export_image(FILE *out, char *filename)
+{
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        printf("bootimg-info: File not found: \"%s\"\n", filename);
+        return 1;
+    }
+    img_info info;
+    if (read_img_info(f, &info) < 0) {
+        printf("bootimg-info: No boot image magic found: \"%s\"\n", filename);
+        fclose(f);
+        return 1;
+    }
+
+    char buf[VENDOR_RAMDISK_TABLE_ENTRY_BOARD_ID_SIZE * 8 + 1];
+    int a, b, c, y, m;
+    int os_valid = decode_os_version(info.os_version, &a, &b, &c, &y, &m);
 
-            printf("  cmdline                         : %.*s\n\n", BOOT_ARGS_SIZE, header.cmdline);
+    export_table *t = &export_tables[0];
+    export_str(t, filename, strlen(filename));
+    export_str(t, info.magic, BOOT_MAGIC_SIZE);
+    export_u32(t, info.magic_offset);
+    export_u32(t, info.header_version);
+    export_u32(t, info.dt_size);
+    export_u32(t, info.page_size);
+    export_u32(t, info.kernel_size);
+    export_u32(t, info.kernel_addr);
+    export_u32(t, info.ramdisk_size);
+    export_u32(t, info.ramdisk_addr);
+    export_u32(t, info.second_size);
+    export_u32(t, info.second_addr);
+    export_u32(t, info.tags_addr);
+    export_u32(t, info.os_version);
+    snprintf(buf, sizeof(buf), "%d.%d.%d", a, b, c);
+    export_str(t, os_valid ? buf : "", sizeof(buf));
+    snprintf(buf, sizeof(buf), "%d-%02d", y, m);
+    export_str(t, os_valid ? buf : "", sizeof(buf));
+    export_str(t, info.name, sizeof(info.name));
+    export_str(t, info.cmdline, sizeof(info.cmdline));
+    export_str(t, info.extra_cmdline, sizeof(info.extra_cmdline));
+    int i;
+    for (i = 0; i < sizeof(info.id); i++) {
+        sprintf(buf + i * 2, "%02hhx", info.id[i]);
+    }
+    export_str(t, !strcmp(info.magic, BOOT_MAGIC) && info.header_version < 3 ? buf : "", sizeof(buf));
+    export_u32(t, info.recovery_dtbo_size);
+    export_u64(t, info.recovery_dtbo_offset);
+    export_u32(t, info.header_size);
+    export_u32(t, info.dtb_size);
+    export_u64(t, info.dtb_addr);
+    export_u32(t, info.signature_size);
+    export_u32(t, info.vendor_ramdisk_size);
+    export_u32(t, info.vendor_ramdisk_table_size);
+    export_u32(t, info.vendor_ramdisk_table_entry_num);
+    export_u32(t, info.vendor_ramdisk_table_entry_size);
+    export_u32(t, info.bootconfig_size);
+    export_u32(t, info.base);
+    export_u32(t, info.kernel_addr - info.base);
+    export_u32(t, info.ramdisk_addr - info.base);
+    export_u32(t, !strcmp(info.magic, BOOT_MAGIC) && info.header_version < 3 ? info.second_addr - info.base : 0);
+    export_u32(t, info.tags_addr - info.base);
+    export_u64(t, info.dtb_addr ? info.dtb_addr - info.base : 0);
+    export_u32(t, info.rdt_offset);
+    export_u32(t, info.bc_offset);
+    export_row_end(out, 0);
 
-            print_id(&header);
+    t = &export_tables[1];
+    fseek(f, info.magic_offset + info.rdt_offset, SEEK_SET);
+    uint32_t rdt_entry_cur;
+    uint32_t rdt_entry_num = rdt_entry_count(&info);
+    for (rdt_entry_cur = 1; rdt_entry_cur <= rdt_entry_num; rdt_entry_cur++) {
+        vendor_ramdisk_table_entry_v4 rdt_entry;
+        read_rdt_entry(f, &info, &rdt_entry);
 
-            printf("  extra_cmdline                   : %.*s\n\n", BOOT_EXTRA_ARGS_SIZE, header.extra_cmdline);
+        export_u64(t, export_image_rows);
+        export_u32(t, rdt_entry_cur);
+        export_u32(t, rdt_entry.ramdisk_size);
+        export_u32(t, rdt_entry.ramdisk_offset);
+        export_u32(t, rdt_entry.ramdisk_type);
+        char *type_name = rdt_type_name(rdt_entry.ramdisk_type);
+        export_str(t, type_name, strlen(type_name));
+        export_str(t, (char *)rdt_entry.ramdisk_name, VENDOR_RAMDISK_NAME_SIZE);
+        for (i = 0; i < VENDOR_RAMDISK_TABLE_ENTRY_BOARD_ID_SIZE; i++) {
+            sprintf(buf + i * 8, "%08x", rdt_entry.board_id[i]);
+        }
+        export_str(t, buf, sizeof(buf));
+        export_row_end(out, 1);
+    }
 
-            if (header.header_version <= hdr_ver_max) {
-                if (header.header_version > 0) {
-                    printf("  recovery_dtbo_size              : %-10d  (%08x)\n", header.recovery_dtbo_size, header.recovery_dtbo_size);
-                    printf("  recovery_dtbo_offset            : %-10"PRId64"  (%016"PRIx64")\n", header.recovery_dtbo_offset, header.recovery_dtbo_offset);
-                    printf("  header_size                     : %-10d  (%08x)\n\n", header.header_size, header.header_size);
-                }
-                if (header.header_version > 1) {
-                    printf("  dtb_size                        : %-10d  (%08x)\n", header.dtb_size, header.dtb_size);
-                    printf("  dtb_addr                        : 0x%08"PRIx64"  (%016"PRIx64")\n\n", header.dtb_addr, header.dtb_addr);
-                }
+    export_image_rows++;
+    fclose(f);
+    return 0;
+}
+
+int export_images(char *out_name, int count, char **filenames)
+{
+    FILE *out = fopen(out_name, "wb");
+    if (!out) {
+        printf("bootimg-info: Could not create \"%s\"!\n", out_name);
+        return 1;
+    }
+
+    export_write(out, EXPORT_MAGIC, strlen(EXPORT_MAGIC));
+    export_write_u32(out, EXPORT_VERSION);
+    export_write_u32(out, export_table_count);
+    int index, c;
+    for (index = 0; index < export_table_count; index++) {
+        export_table *t = &export_tables[index];
+        export_write_str(out, t->name);
+        export_write_u32(out, t->ncols);
+        for (c = 0; c < t->ncols; c++) {
+            uint8_t type = t->cols[c].type;
+            export_write(out, &type, sizeof(type));
+            export_write_str(out, t->cols[c].name);
+        }
+    }
+
+    int ret = 0;
+    int n;
+    for (n = 0; n < count; n++) {
+        if (strcmp(filenames[n], "-")) {
+            ret |= export_image(out, filenames[n]);
+            continue;
+        }
+        // "-" reads one image path per line from stdin, for corpora too large for the command line
+        char line[4096];
+        while (fgets(line, sizeof(line), stdin)) {
+            line[strcspn(line, "\r\n")] = '\0';
+            if (line[0] != '\0') {
+                ret |= export_image(out, line);
             }
+        }
+    }
+
+    for (index = 0; index < export_table_count; index++) {
+        export_flush(out, index);
+    }
+    export_write_u32(out, EXPORT_END);
+    if (fclose(out)) {
+        printf("bootimg-info: Write failed!\n");
+        return 1;
+    }
+    return ret;
+}
+
+int print_info(char *filename)
+{
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        printf("bootimg-info: File not found!\n");
+        return 1;
+    }
+
+    img_info info;
+    if (read_img_info(f, &info) < 0) {
+        printf("bootimg-info: No boot image magic found!\n");
+        fclose(f);
+        return 1;
+    }
+    char *magic = info.magic;
+    int i = info.magic_offset;
+    find_section_wrappers(f, &info);
+
+    printf(" Android Boot Image Info Utility\n\n");
+
+    printf(" Printing information for \"%s\":\n\n", filename);
+
+    printf(" header:\n");
+
+    uint8_t hdr[sizeof(vendor_boot_img_hdr_v4)];
+    memset(hdr, 0, sizeof(hdr));
+    fseek(f, i, SEEK_SET);
+    if(fread(hdr, sizeof(hdr), 1, f)){};
+
+    int field_count, version;
+    hdr_field *fields = select_fields(magic, hdr, &field_count, &version);
+    print_fields(fields, field_count, version, hdr);
+
+    int base = 0;
+
+    if (!strcmp(magic, BOOT_MAGIC)) {
+        if (version < 3) {
+            boot_img_hdr_v2 *header = (boot_img_hdr_v2 *)hdr;
+
+            base = header->kernel_addr - 0x00008000;
 
             printf(" Other:\n");
             printf("  magic offset                    : %-10d  (%08x)\n\n", i, i);
             printf("  base address                    : 0x%08x\n\n", base);
 
-            printf("  kernel offset                   : 0x%08x\n", header.kernel_addr - base);
-            printf("  ramdisk offset                  : 0x%08x\n", header.ramdisk_addr - base);
-            printf("  second offset                   : 0x%08x\n", header.second_addr - base);
-            printf("  tags offset                     : 0x%08x\n", header.tags_addr - base);
-            if (header.header_version <= hdr_ver_max && header.header_version > 1) {
-                printf("  dtb offset                      : 0x%08"PRIx64"\n", header.dtb_addr - base);
+            printf("  kernel offset                   : 0x%08x\n", header->kernel_addr - base);
+            printf("  ramdisk offset                  : 0x%08x\n", header->ramdisk_addr - base);
+            printf("  second offset                   : 0x%08x\n", header->second_addr - base);
+            printf("  tags offset                     : 0x%08x\n", header->tags_addr - base);
+            if (version > 1) {
+                printf("  dtb offset                      : 0x%08"PRIx64"\n", header->dtb_addr - base);
             }
 
         } else {
-            // boot_img_hdr_v3 and above are no longer backwards compatible
-
-            printf("  magic                           : ANDROID!\n");
-            printf("  kernel_size                     : %-10d  (%08x)\n", header.kernel_size, header.kernel_size);
-            printf("  ramdisk_size                    : %-10d  (%08x)\n\n", header.ramdisk_size, header.ramdisk_size);
-
-            print_os_version(header.os_version);
-            printf("  header_size                     : %-10d  (%08x)\n", header.header_size, header.header_size);
-            printf("  reserved[1]                     : %-10d  (%08x)\n", header.reserved[0], header.reserved[0]);
-            printf("  reserved[2]                     : %-10d  (%08x)\n\n", header.reserved[1], header.reserved[1]);
-
-            printf("  reserved[3]                     : %-10d  (%08x)\n", header.reserved[2], header.reserved[2]);
-            printf("  reserved[4]                     : %-10d  (%08x)\n", header.reserved[3], header.reserved[3]);
-            printf("  header_version                  : %-10d  (%08x)\n", header.header_version, header.header_version);
-            printf("  cmdline                         : %.*s\n", BOOT_ARGS_SIZE+BOOT_EXTRA_ARGS_SIZE, header.cmdline);
-            if (header.header_version > 3) {
-                printf("  signature_size                  : %-10d  (%08x)\n", header.signature_size, header.signature_size);
-            }
             printf("\n");
 
             printf(" Other:\n");
@@ -185,84 +2024,38 @@ int main(int argc, char** argv)
         }
 
     } else {
-        // vendor_boot_img_hdr started at v3 and is not cross-compatible with boot_img_hdr
-
-        fseek(f, i, SEEK_SET);
-        vendor_boot_img_hdr_v4 header;
-        if(fread(&header, sizeof(header), 1, f)){};
+        vendor_boot_img_hdr_v4 *header = (vendor_boot_img_hdr_v4 *)hdr;
 
         vendor_ramdisk_table_entry_v4 rdt_entry;
-        int rdt_offset;
-        int bc_offset;
-        if (header.header_version > 3) {
-            rdt_offset = ((header.header_size + header.page_size - 1) / header.page_size
-                + (header.vendor_ramdisk_size + header.page_size - 1) / header.page_size
-                + (header.dtb_size + header.page_size - 1) / header.page_size) * header.page_size;
-
-            bc_offset = ((header.header_size + header.page_size - 1) / header.page_size
-                + (header.vendor_ramdisk_size + header.page_size - 1) / header.page_size
-                + (header.dtb_size + header.page_size - 1) / header.page_size
-                + (header.vendor_ramdisk_table_size + header.page_size - 1) / header.page_size) * header.page_size;
-        }
-
-        base = header.kernel_addr - 0x00008000;
-
-        printf("  magic                           : VNDRBOOT\n");
-        printf("  header_version                  : %-10d  (%08x)\n", header.header_version, header.header_version);
-        printf("  page_size                       : %-10d  (%08x)\n\n", header.page_size, header.page_size);
+        int rdt_offset = info.rdt_offset;
+        int bc_offset = info.bc_offset;
 
-        printf("  kernel_addr                     : 0x%08x\n", header.kernel_addr);
-        printf("  ramdisk_addr                    : 0x%08x\n", header.ramdisk_addr);
-        printf("  vendor_ramdisk_size             : %-10d  (%08x)\n", header.vendor_ramdisk_size, header.vendor_ramdisk_size);
-        printf("  cmdline                         : %.*s\n", VENDOR_BOOT_ARGS_SIZE, header.cmdline);
-        printf("  tags_addr                       : 0x%08x\n\n", header.tags_addr);
+        base = header->kernel_addr - 0x00008000;
 
-        printf("  name                            : %s\n\n", header.name);
-
-        printf("  header_size                     : %-10d  (%08x)\n", header.header_size, header.header_size);
-        printf("  dtb_size                        : %-10d  (%08x)\n", header.dtb_size, header.dtb_size);
-        printf("  dtb_addr                        : 0x%08"PRIx64"  (%016"PRIx64")\n\n", header.dtb_addr, header.dtb_addr);
-
-        if (header.header_version > 3) {
-            printf("  vendor_ramdisk_table_size       : %-10d  (%08x)\n", header.vendor_ramdisk_table_size, header.vendor_ramdisk_table_size);
-            printf("  vendor_ramdisk_table_entry_num  : %-10d  (%08x)\n", header.vendor_ramdisk_table_entry_num, header.vendor_ramdisk_table_entry_num);
-            printf("  vendor_ramdisk_table_entry_size : %-10d  (%08x)\n", header.vendor_ramdisk_table_entry_size, header.vendor_ramdisk_table_entry_size);
-            printf("  bootconfig_size                 : %-10d  (%08x)\n\n", header.bootconfig_size, header.bootconfig_size);
-
-            fseek(f, rdt_offset, SEEK_SET);
-            int rdt_entry_cur;
-            for (rdt_entry_cur = 1; rdt_entry_cur <= header.vendor_ramdisk_table_entry_num; rdt_entry_cur++) {
-                if(fread(&rdt_entry, header.vendor_ramdisk_table_entry_size, 1, f)){};
-                char *rdt_type_name;
-                switch (rdt_entry.ramdisk_type) {
-                    case 0:
-                        rdt_type_name = "NONE";
-                        break;
-                    case 1:
-                        rdt_type_name = "PLATFORM";
-                        break;
-                    case 2:
-                        rdt_type_name = "RECOVERY";
-                        break;
-                    case 3:
-                        rdt_type_name = "DLKM";
-                        break;
-                }
+        if (header->header_version > 3) {
+            fseek(f, i + rdt_offset, SEEK_SET);
+            uint32_t rdt_entry_cur;
+            uint32_t rdt_entry_num = rdt_entry_count(&info);
+            for (rdt_entry_cur = 1; rdt_entry_cur <= rdt_entry_num; rdt_entry_cur++) {
+                read_rdt_entry(f, &info, &rdt_entry);
 
-                printf(" vendor_ramdisk_table_entry: %d\n", rdt_entry_cur);
+                printf(" vendor_ramdisk_table_entry: %u\n", rdt_entry_cur);
                 printf("  ramdisk_size                    : %-10d  (%08x)\n", rdt_entry.ramdisk_size, rdt_entry.ramdisk_size);
                 printf("  ramdisk_offset                  : %-10d  (%08x)\n", rdt_entry.ramdisk_offset, rdt_entry.ramdisk_offset);
-                printf("  ramdisk_type                    : %-10d  (%08x): %s\n", rdt_entry.ramdisk_type, rdt_entry.ramdisk_type, rdt_type_name);
+                printf("  ramdisk_type                    : %-10d  (%08x): %s\n", rdt_entry.ramdisk_type, rdt_entry.ramdisk_type, rdt_type_name(rdt_entry.ramdisk_type));
                 printf("  ramdisk_name                    : %s\n\n", rdt_entry.ramdisk_name);
 
                 printf("  board_id                        : %ls\n\n", rdt_entry.board_id);
             }
 
-            fseek(f, bc_offset, SEEK_SET);
-            char bootconfig[header.bootconfig_size];
-            if(fread(bootconfig, header.bootconfig_size, 1, f)){};
+            // never trust bootconfig_size beyond what the file holds, it sizes a stack buffer
+            uint64_t bc_start = i + bc_offset;
+            uint32_t bc_size = bc_start > info.file_size ? 0 : info.file_size - bc_start < header->bootconfig_size ? info.file_size - bc_start : header->bootconfig_size;
+            fseek(f, bc_start, SEEK_SET);
+            char bootconfig[bc_size + 1];
+            if(fread(bootconfig, bc_size, 1, f)){};
 
-            printf(" bootconfig: %.*s\n", header.bootconfig_size, bootconfig);
+            printf(" bootconfig: %.*s\n", bc_size, bootconfig);
         }
 
         printf(" Other:\n");
@@ -270,11 +2063,11 @@ int main(int argc, char** argv)
 
         printf("  base address                    : 0x%08x\n\n", base);
 
-        printf("  kernel offset                   : 0x%08x\n", header.kernel_addr - base);
-        printf("  ramdisk offset                  : 0x%08x\n", header.ramdisk_addr - base);
-        printf("  tags offset                     : 0x%08x\n", header.tags_addr - base);
-        printf("  dtb offset                      : 0x%08"PRIx64"\n", header.dtb_addr - base);
-        if (header.header_version > 3) {
+        printf("  kernel offset                   : 0x%08x\n", header->kernel_addr - base);
+        printf("  ramdisk offset                  : 0x%08x\n", header->ramdisk_addr - base);
+        printf("  tags offset                     : 0x%08x\n", header->tags_addr - base);
+        printf("  dtb offset                      : 0x%08"PRIx64"\n", header->dtb_addr - base);
+        if (header->header_version > 3) {
             printf("\n");
 
             printf("  vendor ramdisk table offset     : %-10d  (%08x)\n", rdt_offset, rdt_offset);
@@ -282,7 +2075,177 @@ int main(int argc, char** argv)
         }
     }
 
+    if (wrapper_count) {
+        printf("\n");
+        print_wrappers();
+    }
+
     printf("\n");
     fclose(f);
     return 0;
 }
+
+#ifdef __linux__
+#define WATCH_DEBOUNCE_MS 1000 // quiet time after the last event on a file before it is inspected
+
+typedef struct {
+    char name[NAME_MAX + 1];
+    int64_t due;
+} watch_entry;
+
+int64_t now_ms()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+int watch_dir(char *dirname)
+{
+    int fd = inotify_init1(IN_CLOEXEC);
+    if (fd < 0 || inotify_add_watch(fd, dirname, IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO) < 0) {
+        printf("bootimg-info: Could not watch \"%s\"!\n", dirname);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return 1;
+    }
+
+    // files with recent events, inspected once they have been quiet for WATCH_DEBOUNCE_MS so partial writes are skipped
+    watch_entry *pending = NULL;
+    int pending_num = 0, pending_max = 0;
+
+    char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    char path[PATH_MAX];
+    int n;
+    for (;;) {
+        int timeout = -1;
+        int64_t now = now_ms();
+        for (n = 0; n < pending_num; n++) {
+            int64_t wait = pending[n].due > now ? pending[n].due - now : 0;
+            if (timeout < 0 || wait < timeout) {
+                timeout = wait;
+            }
+        }
+
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        int ret = poll(&pfd, 1, timeout);
+        if (ret < 0 && errno != EINTR) {
+            break;
+        }
+        if (ret > 0) {
+            ssize_t len = read(fd, buf, sizeof(buf));
+            if (len <= 0) {
+                break;
+            }
+            now = now_ms();
+            char *p;
+            for (p = buf; p < buf + len; p += sizeof(struct inotify_event) + ((struct inotify_event *)p)->len) {
+                struct inotify_event *event = (struct inotify_event *)p;
+                // hidden names are the usual temporary files of downloads and rsync before the rename into place
+                if (!event->len || (event->mask & IN_ISDIR) || event->name[0] == '.') {
+                    continue;
+                }
+                for (n = 0; n < pending_num; n++) {
+                    if (!strcmp(pending[n].name, event->name)) {
+                        break;
+                    }
+                }
+                if (n == pending_num) {
+                    if (pending_num == pending_max) {
+                        pending_max = pending_max ? pending_max * 2 : 16;
+                        pending = realloc(pending, pending_max * sizeof(watch_entry));
+                        if (!pending) {
+                            printf("bootimg-info: Out of memory!\n");
+                            return 1;
+                        }
+                    }
+                    snprintf(pending[n].name, sizeof(pending[n].name), "%s", event->name);
+                    pending_num++;
+                }
+                pending[n].due = now + WATCH_DEBOUNCE_MS;
+            }
+        }
+
+        now = now_ms();
+        for (n = 0; n < pending_num; ) {
+            if (pending[n].due > now) {
+                n++;
+                continue;
+            }
+            snprintf(path, sizeof(path), "%s/%s", dirname, pending[n].name);
+            print_record(path);
+            fflush(stdout);
+            pending[n] = pending[--pending_num];
+        }
+    }
+
+    printf("bootimg-info: Watch on \"%s\" failed!\n", dirname);
+    free(pending);
+    close(fd);
+    return 1;
+}
+#else
+int watch_dir(char *dirname)
+{
+    printf("bootimg-info: --watch is only supported on Linux!\n");
+    return 1;
+}
+#endif
+
+int main(int argc, char** argv)
+{
+    char *filename = NULL;
+    argc--;
+    if (argc > 0 && !strcmp(argv[1], "--field")) {
+        if (argc < 3) {
+            return usage();
+        }
+        return query_fields(argv[3], argv[2]);
+    }
+    if (argc > 0 && !strcmp(argv[1], "--export")) {
+        if (argc < 3) {
+            return usage();
+        }
+        return export_images(argv[2], argc - 2, argv + 3);
+    }
+    if (argc > 0 && !strcmp(argv[1], "--extract")) {
+        if (argc < 3) {
+            return usage();
+        }
+        return extract_sections(argv[3], argv[2], argc > 3 ? argv[4] : ".");
+    }
+    if (argc > 0 && !strcmp(argv[1], "--patch")) {
+        if (argc < 2) {
+            return usage();
+        }
+        return patch_image(argv[2], argc - 2, argv + 3);
+    }
+    if (argc > 0 && !strcmp(argv[1], "--fingerprint")) {
+        int full = argc > 1 && !strcmp(argv[2], "--full");
+        if (argc < 2 + full) {
+            return usage();
+        }
+        return fingerprint_image(argv[2 + full], argc > 2 + full ? argv[3 + full] : NULL, full);
+    }
+    if (argc > 0 && !strcmp(argv[1], "--audit")) {
+        if (argc < 2) {
+            return usage();
+        }
+        return audit_image(argv[2]);
+    }
+    if (argc > 0 && !strcmp(argv[1], "--watch")) {
+        if (argc < 2) {
+            return usage();
+        }
+        return watch_dir(argv[2]);
+    }
+    if (argc > 0) {
+        char *val = argv[1];
+        filename = val;
+    }
+    if (filename == NULL) {
+        return usage();
+    }
+    return print_info(filename);
+}